@@ -0,0 +1,174 @@
+
+#include <iostream>
+#include <new>
+#include <cstdlib>
+#include <boost/tokenizer.hpp>
+
+//configuration
+#define ST_ASIO_SERVER_PORT		9530
+#define ST_ASIO_REUSE_OBJECT //use objects pool
+#define ST_ASIO_SYNC_DISPATCH //dispatch messages in the reading (no boost::function for dispatching)
+#define ST_ASIO_INPUT_CONTAINER pooled_list //recycle nodes of the send buffer
+#define ST_ASIO_OUTPUT_CONTAINER pooled_list //recycle nodes of the recv buffer
+#define ST_ASIO_POOLED_LIST //recycle nodes of the temporary message containers (like the one passed to on_msg)
+#define ST_ASIO_DEFAULT_UNPACKER stream_unpacker //non-protocol
+//#define ST_ASIO_DELAY_CLOSE	5 //test the untracked completion handlers (see executor and tracked_executor)
+//#define ST_ASIO_NO_HANDLER_ALLOCATOR //compare it with the boost::function based completion handlers
+//configuration
+
+#include "../include/ext/tcp.h"
+using namespace st_asio_wrapper;
+using namespace st_asio_wrapper::tcp;
+using namespace st_asio_wrapper::ext::tcp;
+
+#define QUIT_COMMAND	"quit"
+
+//count heap allocations of the whole process, messages shorter than 16 bytes are kept in std::string itself (small string optimization),
+//so after the warming up, all allocations come from st_asio_wrapper and asio during the reading, writing and dispatching.
+boost::atomic_size_t allocation_num(0);
+#if defined(__GNUC__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete" //false alarm after operator delete been inlined
+#endif
+void* operator new(size_t size)
+{
+	++allocation_num;
+	void* p = malloc(0 == size ? 1 : size);
+	if (NULL == p)
+		throw std::bad_alloc();
+
+	return p;
+}
+void operator delete(void* p) throw() {free(p);}
+
+boost::atomic_ushort completed_session_num;
+
+class echo_socket : public server_socket
+{
+public:
+	echo_socket(i_server& server_) : server_socket(server_) {}
+
+protected:
+	virtual size_t on_msg(list<out_msg_type>& msg_can)
+	{
+		for (BOOST_AUTO(iter, msg_can.begin()); iter != msg_can.end(); ++iter) direct_send_msg(*iter);
+		BOOST_AUTO(re, msg_can.size());
+		msg_can.clear();
+
+		return re;
+	}
+};
+
+class pingpong_socket : public client_socket
+{
+public:
+	pingpong_socket(i_matrix& matrix_) : client_socket(matrix_) {}
+
+	void begin(size_t msg_num, const std::string& msg)
+	{
+		total_bytes = msg.size() * msg_num;
+		recv_bytes = 0;
+
+		send_native_msg(msg);
+	}
+
+protected:
+	virtual size_t on_msg(list<out_msg_type>& msg_can)
+	{
+		for (BOOST_AUTO(iter, msg_can.begin()); iter != msg_can.end(); ++iter)
+		{
+			recv_bytes += iter->size();
+			if (recv_bytes < total_bytes)
+				direct_send_msg(*iter);
+			else if (recv_bytes == total_bytes)
+				--completed_session_num;
+		}
+		BOOST_AUTO(re, msg_can.size());
+		msg_can.clear();
+
+		return re;
+	}
+
+private:
+	size_t total_bytes, recv_bytes;
+};
+
+class pingpong_client : public multi_client_base<pingpong_socket>
+{
+public:
+	pingpong_client(service_pump& service_pump_) : multi_client_base<pingpong_socket>(service_pump_) {}
+
+	void begin(size_t msg_num, const std::string& msg) {do_something_to_all(boost::bind(&pingpong_socket::begin, boost::placeholders::_1, msg_num, boost::cref(msg)));}
+};
+
+void pingpong(pingpong_client& client, size_t link_num, size_t msg_num, const std::string& msg)
+{
+	completed_session_num = (unsigned short) link_num;
+	client.begin(msg_num, msg);
+	while (0 != completed_session_num)
+		boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
+}
+
+int main(int argc, const char* argv[])
+{
+	printf("usage: %s [<service thread number=1> [<link num=16>]]\n", argv[0]);
+	if (argc >= 2 && (0 == strcmp(argv[1], "--help") || 0 == strcmp(argv[1], "-h")))
+		return 0;
+	else
+		puts("type " QUIT_COMMAND " to end.");
+
+	size_t link_num = 16;
+	if (argc > 2)
+		link_num = std::min(ST_ASIO_MAX_OBJECT_NUM, std::max(atoi(argv[2]), 1));
+
+	int thread_num = 1;
+	if (argc > 1)
+		thread_num = std::min(16, std::max(thread_num, atoi(argv[1])));
+
+#ifdef ST_ASIO_HANDLER_ALLOCATOR
+	puts("completion handlers: concrete types with per-socket memory (see macro ST_ASIO_HANDLER_ALLOCATOR)");
+#else
+	puts("completion handlers: boost::function");
+#endif
+
+	service_pump sp;
+	server_base<echo_socket> server_(sp);
+	pingpong_client client(sp);
+	for (size_t i = 0; i < link_num; ++i)
+		client.add_socket();
+
+	sp.start_service(thread_num);
+	while(sp.is_running())
+	{
+		std::string str;
+		std::getline(std::cin, str);
+		if (str.empty())
+			;
+		else if (QUIT_COMMAND == str)
+			sp.stop_service();
+		else
+		{
+			size_t msg_num = 10000;
+			size_t msg_len = 8;
+
+			boost::char_separator<char> sep(" \t");
+			boost::tokenizer<boost::char_separator<char> > tok(str, sep);
+			BOOST_AUTO(iter, tok.begin());
+			if (iter != tok.end()) msg_num = std::max((size_t) atoi(iter++->data()), (size_t) 1);
+			if (iter != tok.end()) msg_len = std::min((size_t) 15, std::max((size_t) atoi(iter++->data()), (size_t) 1));
+
+			printf("test parameters after adjustment: " ST_ASIO_SF " " ST_ASIO_SF "\n", msg_num, msg_len);
+			std::string msg(msg_len, '0');
+
+			pingpong(client, link_num, 100, msg); //warm up, fill the per-thread caches and the recycled nodes
+			size_t begin_num = allocation_num;
+			pingpong(client, link_num, msg_num, msg);
+			size_t total_num = allocation_num - begin_num;
+
+			//each message has been read and written twice (by the client and by the server)
+			printf("%u links, " ST_ASIO_SF " pingpongs, " ST_ASIO_SF " heap allocations, %f per read/write.\n",
+				(unsigned) link_num, link_num * msg_num, total_num, total_num / 4.0 / link_num / msg_num);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,228 @@
+#include <iostream>
+#include <boost/timer/timer.hpp>
+#include <boost/tokenizer.hpp>
+
+//configuration
+#define ST_ASIO_SERVER_PORT		9527
+#define ST_ASIO_REUSE_OBJECT //use objects pool
+#define ST_ASIO_SYNC_SEND //coroutine_socket needs it
+#define ST_ASIO_MSG_BUFFER_SIZE	65536
+#define ST_ASIO_DEFAULT_UNPACKER stream_unpacker //non-protocol
+//configuration
+
+#include "../include/ext/tcp.h"
+#include "../include/tcp/coroutine_socket.h"
+using namespace st_asio_wrapper;
+using namespace st_asio_wrapper::tcp;
+using namespace st_asio_wrapper::ext::tcp;
+
+#define QUIT_COMMAND	"quit"
+#define STATUS			"status"
+#define STATISTIC		"statistic"
+#define LIST_ALL_CLIENT	"list all client"
+
+//pingpong latency test (one message in flight per link) against pingpong_server, compare coroutines (coroutine_socket) with callbacks.
+boost::timer::cpu_timer begin_time;
+boost::atomic_ushort completed_session_num;
+boost::atomic_uint_fast64_t total_latency; //nanoseconds
+
+class callback_socket : public client_socket
+{
+public:
+	callback_socket(i_matrix& matrix_) : client_socket(matrix_) {}
+
+	void begin(size_t msg_num, const std::string& msg_)
+	{
+		total_num = msg_num;
+		msg = msg_;
+		recv_bytes = 0;
+		latency = boost::chrono::steady_clock::duration::zero();
+
+		send_round();
+	}
+
+protected:
+	virtual void on_connect() {boost::asio::ip::tcp::no_delay option(true); lowest_layer().set_option(option); client_socket::on_connect();}
+
+	//msg handling
+	virtual bool on_msg_handle(out_msg_type& msg_)
+	{
+		recv_bytes += msg_.size();
+		if (recv_bytes >= msg.size())
+		{
+			latency += boost::chrono::steady_clock::now() - round_begin_time;
+			recv_bytes = 0;
+			if (--total_num > 0)
+				send_round();
+			else
+			{
+				total_latency += boost::chrono::duration_cast<boost::chrono::nanoseconds>(latency).count();
+				--completed_session_num;
+			}
+		}
+
+		return true;
+	}
+	//msg handling end
+
+private:
+	void send_round() {round_begin_time = boost::chrono::steady_clock::now(); send_msg(msg, true);}
+
+private:
+	size_t total_num, recv_bytes;
+	std::string msg;
+	boost::chrono::steady_clock::time_point round_begin_time;
+	boost::chrono::steady_clock::duration latency;
+};
+
+class echo_socket : public coroutine_socket<client_socket>
+{
+public:
+	echo_socket(i_matrix& matrix_) : coroutine_socket<client_socket>(matrix_) {}
+
+	void begin(size_t msg_num, const std::string& msg) {pingpong(msg_num, msg);}
+
+protected:
+	virtual void on_connect() {boost::asio::ip::tcp::no_delay option(true); lowest_layer().set_option(option); coroutine_socket<client_socket>::on_connect();}
+
+private:
+	//the same logic as callback_socket, but no state machine (total_num, recv_bytes and round_begin_time are all local variables)
+	detached_coroutine pingpong(size_t msg_num, std::string msg)
+	{
+		if (!co_await connect()) //the link may be established already (multi_client_base starts sockets with the service), then it completes at once
+		{
+			--completed_session_num;
+			co_return;
+		}
+
+		boost::chrono::steady_clock::duration latency = boost::chrono::steady_clock::duration::zero();
+		for (size_t i = 0; i < msg_num; ++i)
+		{
+			BOOST_AUTO(round_begin_time, boost::chrono::steady_clock::now());
+			if (SUCCESS != co_await send_msg(msg, true))
+				break;
+
+			for (size_t recv_bytes = 0; recv_bytes < msg.size();)
+			{
+				out_msg_type msg_ = co_await recv_msg();
+				if (msg_.empty()) //link broken
+					co_return;
+
+				recv_bytes += msg_.size();
+			}
+			latency += boost::chrono::steady_clock::now() - round_begin_time;
+		}
+
+		total_latency += boost::chrono::duration_cast<boost::chrono::nanoseconds>(latency).count();
+		--completed_session_num;
+	}
+};
+
+template<typename Socket> class echo_client : public multi_client_base<Socket>
+{
+public:
+	echo_client(service_pump& service_pump_) : multi_client_base<Socket>(service_pump_) {}
+
+	void begin(size_t msg_num, const std::string& msg) {ST_THIS do_something_to_all(boost::bind(&Socket::begin, boost::placeholders::_1, msg_num, boost::cref(msg)));}
+};
+
+int main(int argc, const char* argv[])
+{
+	printf("usage: %s [<service thread number=1> [<port=%d> [<ip=%s> [link num=16]]]]\n", argv[0], ST_ASIO_SERVER_PORT, ST_ASIO_SERVER_IP);
+	if (argc >= 2 && (0 == strcmp(argv[1], "--help") || 0 == strcmp(argv[1], "-h")))
+		return 0;
+	else
+		puts("type " QUIT_COMMAND " to end.");
+
+	///////////////////////////////////////////////////////////
+	size_t link_num = 16;
+	if (argc > 4)
+		link_num = std::min(ST_ASIO_MAX_OBJECT_NUM, std::max(atoi(argv[4]), 1));
+
+	printf("exec: coroutine_client with " ST_ASIO_SF " links\n", link_num);
+	///////////////////////////////////////////////////////////
+
+	service_pump sp;
+	echo_client<callback_socket> client(sp);
+	echo_client<echo_socket> co_client(sp);
+
+	std::string ip = argc > 3 ? argv[3] : ST_ASIO_SERVER_IP;
+	unsigned short port = argc > 2 ? atoi(argv[2]) : ST_ASIO_SERVER_PORT;
+
+	int thread_num = 1;
+	if (argc > 1)
+		thread_num = std::min(16, std::max(thread_num, atoi(argv[1])));
+
+	for (size_t i = 0; i < link_num; ++i)
+	{
+		client.add_socket(port, ip);
+		co_client.add_socket(port, ip);
+	}
+
+	sp.start_service(thread_num);
+	while(sp.is_running())
+	{
+		std::string str;
+		std::getline(std::cin, str);
+		if (str.empty())
+			;
+		else if (QUIT_COMMAND == str)
+			sp.stop_service();
+		else if (STATISTIC == str)
+		{
+			puts(client.get_statistic().to_string().data());
+			puts(co_client.get_statistic().to_string().data());
+		}
+		else if (STATUS == str)
+		{
+			client.list_all_status();
+			co_client.list_all_status();
+		}
+		else if (LIST_ALL_CLIENT == str)
+		{
+			client.list_all_object();
+			co_client.list_all_object();
+		}
+		else
+		{
+			size_t msg_num = 1024;
+			size_t msg_len = 1024;
+			char mode = 1; //0 callbacks, 1 coroutines
+
+			boost::char_separator<char> sep(" \t");
+			boost::tokenizer<boost::char_separator<char> > tok(str, sep);
+			BOOST_AUTO(iter, tok.begin());
+			if (iter != tok.end()) msg_num = std::max((size_t) atoi(iter++->data()), (size_t) 1);
+			if (iter != tok.end()) msg_len = std::min((size_t) ST_ASIO_MSG_BUFFER_SIZE, std::max((size_t) atoi(iter++->data()), (size_t) 1));
+			if (iter != tok.end()) mode = *iter++->data() - '0';
+
+			if (0 != mode && 1 != mode)
+			{
+				puts("unrecognized mode!");
+				continue;
+			}
+
+			printf("test parameters after adjustment: " ST_ASIO_SF " " ST_ASIO_SF " %d\n", msg_num, msg_len, mode);
+			puts("performance test begin, this application will have no response during the test!");
+
+			completed_session_num = (unsigned short) link_num;
+			total_latency = 0;
+			std::string msg(msg_len, '0');
+			begin_time.start();
+			if (0 == mode)
+				client.begin(msg_num, msg);
+			else
+				co_client.begin(msg_num, msg);
+
+			while (0 != completed_session_num)
+				boost::this_thread::sleep_for(boost::chrono::milliseconds(50));
+			begin_time.stop();
+
+			double used_time = (double) begin_time.elapsed().wall / 1000000000;
+			printf("%s finished in %f seconds, TPS: %f(*2), average latency: %f microseconds.\n", 0 == mode ? "callbacks" : "coroutines",
+				used_time, link_num * msg_num / used_time, total_latency / 1000.0 / link_num / msg_num);
+		}
+	}
+
+	return 0;
+}
@@ -10,6 +10,12 @@
 #define ST_ASIO_CLEAR_OBJECT_INTERVAL 1
 #define ST_ASIO_SYNC_DISPATCH
 #define ST_ASIO_DISPATCH_BATCH_MSG
+//#define ST_ASIO_INPUT_QUEUE mpsc_queue //lock-free for producers, worth trying if many threads send messages to the same link
+//#define ST_ASIO_INPUT_QUEUE lane_queue //multiple lanes with weighted round-robin or strict priority, see send_msg_in_lane
+//#define ST_ASIO_OUTPUT_QUEUE spsc_queue //wait-free, receive buffer only has one producer and one consumer
+//#define ST_ASIO_OUTPUT_CONTAINER deque
+//#define ST_ASIO_INPUT_CONTAINER pooled_list //recycle nodes via per-thread free lists, compare it with the default list
+//#define ST_ASIO_OUTPUT_CONTAINER pooled_list //don't use it together with deque
 //#define ST_ASIO_WANT_MSG_SEND_NOTIFY
 //#define ST_ASIO_FULL_STATISTIC //full statistic will slightly impact performance
 //#define ST_ASIO_USE_STEADY_TIMER
@@ -17,6 +23,8 @@
 //#define ST_ASIO_DECREASE_THREAD_AT_RUNTIME
 //#define ST_ASIO_MAX_SEND_BUF	65536
 //#define ST_ASIO_MAX_RECV_BUF	65536
+//#define ST_ASIO_SEND_COALESCE_SIZE	128 //copy small messages into one buffer before sending, try it with small msg_len
+//#define ST_ASIO_SEND_WINDOW //software cork, hold messages on idle links for a while and then send them together
 //if there's a huge number of links, please reduce messge buffer via ST_ASIO_MAX_SEND_BUF and ST_ASIO_MAX_RECV_BUF macro.
 //please think about if we have 512 links, how much memory we can accupy at most with default ST_ASIO_MAX_SEND_BUF and ST_ASIO_MAX_RECV_BUF?
 //it's 2 * 1M * 512 = 1G
@@ -27,6 +35,8 @@
 //1-packer2 and unpacker2, head(length) + body
 //2-fixed length packer and unpacker
 //3-prefix and/or suffix packer and unpacker
+//4-default packer and ring buffer unpacker (real scatter-gather receiving), head(length) + body, compatible with 0
+//5-varint packer and unpacker, varint head(length) + body, compatible with echo_server's 6
 
 #if 0 == PACKER_UNPACKER_TYPE
 #define ST_ASIO_HUGE_MSG
@@ -47,6 +57,17 @@
 #elif 3 == PACKER_UNPACKER_TYPE
 #define ST_ASIO_DEFAULT_PACKER prefix_suffix_packer
 #define ST_ASIO_DEFAULT_UNPACKER prefix_suffix_unpacker
+#elif 4 == PACKER_UNPACKER_TYPE
+#define ST_ASIO_HUGE_MSG
+#define ST_ASIO_MSG_BUFFER_SIZE 1000000
+#define ST_ASIO_MAX_SEND_BUF (10 * ST_ASIO_MSG_BUFFER_SIZE)
+#define ST_ASIO_MAX_RECV_BUF (10 * ST_ASIO_MSG_BUFFER_SIZE)
+#define ST_ASIO_RECV_BUFFER_TYPE std::vector<boost::asio::mutable_buffer> //scatter-gather buffer
+#define ST_ASIO_SCATTERED_RECV_BUFFER //ring_unpacker is only available with this macro
+#define ST_ASIO_DEFAULT_UNPACKER ring_unpacker<>
+#elif 5 == PACKER_UNPACKER_TYPE
+#define ST_ASIO_DEFAULT_PACKER varint_packer<>
+#define ST_ASIO_DEFAULT_UNPACKER varint_unpacker<>
 #endif
 //configuration
 
@@ -558,7 +579,7 @@ int main(int argc, const char* argv[])
 			BOOST_AUTO(iter, parameters.begin());
 			if (iter != parameters.end()) msg_num = std::max((size_t) atoi(iter++->data()), (size_t) 1);
 
-#if 0 == PACKER_UNPACKER_TYPE || 1 == PACKER_UNPACKER_TYPE
+#if 0 == PACKER_UNPACKER_TYPE || 1 == PACKER_UNPACKER_TYPE || 4 == PACKER_UNPACKER_TYPE
 			if (iter != parameters.end()) msg_len = std::min(packer<>::get_max_msg_size(),
 				std::max((size_t) atoi(iter++->data()), sizeof(size_t))); //include seq
 #elif 2 == PACKER_UNPACKER_TYPE
@@ -567,6 +588,9 @@ int main(int argc, const char* argv[])
 #elif 3 == PACKER_UNPACKER_TYPE
 			if (iter != parameters.end()) msg_len = std::min((size_t) ST_ASIO_MSG_BUFFER_SIZE,
 				std::max((size_t) atoi(iter++->data()), sizeof(size_t))); //include seq
+#elif 5 == PACKER_UNPACKER_TYPE
+			if (iter != parameters.end()) msg_len = std::min(varint_packer<>::get_max_msg_size(),
+				std::max((size_t) atoi(iter++->data()), sizeof(size_t))); //include seq
 #endif
 			if (iter != parameters.end()) msg_fill = *iter++->data();
 			if (iter != parameters.end()) mode = *iter++->data() - '0';
@@ -1,5 +1,6 @@
 
 #include <iostream>
+#include <fstream>
 
 //configuration
 #define ST_ASIO_SERVER_PORT		9528
@@ -7,13 +8,30 @@
 //#define ST_ASIO_FREE_OBJECT_INTERVAL 60 //it's useless if ST_ASIO_REUSE_OBJECT macro been defined
 //#define ST_ASIO_SYNC_DISPATCH //do not open this feature, see below for more details
 #define ST_ASIO_DISPATCH_BATCH_MSG
+//#define ST_ASIO_OUTPUT_QUEUE spsc_queue //wait-free, receive buffer only has one producer and one consumer
+//#define ST_ASIO_OUTPUT_CONTAINER deque
+//#define ST_ASIO_INPUT_CONTAINER pooled_list //recycle nodes via per-thread free lists, compare it with the default list
+//#define ST_ASIO_OUTPUT_CONTAINER pooled_list //don't use it together with deque
 //#define ST_ASIO_FULL_STATISTIC //full statistic will slightly impact performance
+//#define ST_ASIO_TSC_CLOCK //measure time consumption in full statistic with rdtsc rather than system_clock, x86 and x86_64 only
+//#define ST_ASIO_COARSE_CLOCK	100 //cached time(NULL) for last_recv_time and last_send_time, refreshed every 100 milliseconds
+//#define ST_ASIO_PER_THREAD_ACI //track asynchronous calls with per-thread counters rather than boost::shared_ptr, try it with many service threads
 #define ST_ASIO_USE_STEADY_TIMER
 #define ST_ASIO_ALIGNED_TIMER
 #define ST_ASIO_AVOID_AUTO_STOP_SERVICE
 //#define ST_ASIO_DECREASE_THREAD_AT_RUNTIME
 //#define ST_ASIO_MAX_SEND_BUF	65536
 //#define ST_ASIO_MAX_RECV_BUF	65536
+//#define ST_ASIO_BUFFER_BUDGET	(64 * 1024 * 1024) //limit the sum of all sockets' send and recv buffers, see the statistic command
+//#define ST_ASIO_SEND_COALESCE_SIZE	128 //copy small messages into one buffer before sending, try it with small msg_len
+//#define ST_ASIO_SEND_WINDOW //software cork, hold messages on idle links for a while and then send them together
+//#define ST_ASIO_LAZY_RECV_BUFFER //idle links hold no receive buffers, use it with PACKER_UNPACKER_TYPE 5 and try the memory usage command
+//#define HANDLER_POOL_THREAD_NUM	4 //dispatch messages in a handler_pool rather than in service threads, try it with SLOW_MSG_FILL
+//#define SLOW_MSG_FILL	'S' //messages filled with this character (see echo_client's msg_fill parameter) take 10 milliseconds to be handled
+//#define DISPATCH_LANE_NUM	8 //dispatch messages of each link in this many lanes (keyed by the sequence number), try it with HANDLER_POOL_THREAD_NUM
+//#define THREAD_PER_CORE //one io_context per cpu and each service thread is pinned to its cpu, the service thread number parameter means
+//how many cpus (from cpu 0) will be used, run it with 1 to N to see the scaling.
+//#define ST_ASIO_SINGLE_THREAD_CONTEXT //no strands, locks and atomic read-modify-writes on the per message path, try it with THREAD_PER_CORE
 //if there's a huge number of links, please reduce messge buffer via ST_ASIO_MAX_SEND_BUF and ST_ASIO_MAX_RECV_BUF macro.
 //please think about if we have 512 links, how much memory we can accupy at most with default ST_ASIO_MAX_SEND_BUF and ST_ASIO_MAX_RECV_BUF?
 //it's 2 * 1M * 512 = 1G
@@ -24,6 +42,9 @@
 //1-packer2 and unpacker2, head(length) + body
 //2-fixed length packer and unpacker
 //3-prefix and/or suffix packer and unpacker
+//4-packer2 with shared_buffer and default unpacker, head(length) + body, compatible with 0, try it with the broadcast bench command
+//5-default packer and slicing unpacker (zero-copy receiving), head(length) + body, compatible with 0 if messages are not bigger than 65536 bytes
+//6-varint packer and unpacker, varint head(length) + body, small messages only pay one byte for the head
 
 #if 0 == PACKER_UNPACKER_TYPE
 #define ST_ASIO_HUGE_MSG
@@ -45,6 +66,22 @@
 #elif 3 == PACKER_UNPACKER_TYPE
 #define ST_ASIO_DEFAULT_PACKER prefix_suffix_packer
 #define ST_ASIO_DEFAULT_UNPACKER prefix_suffix_unpacker
+#elif 4 == PACKER_UNPACKER_TYPE
+#define ST_ASIO_HUGE_MSG
+#define ST_ASIO_MSG_BUFFER_SIZE 1000000
+#define ST_ASIO_MAX_SEND_BUF (10 * ST_ASIO_MSG_BUFFER_SIZE)
+#define ST_ASIO_MAX_RECV_BUF (10 * ST_ASIO_MSG_BUFFER_SIZE)
+#define ST_ASIO_DEFAULT_PACKER packer2<shared_buffer<std::string>, std::string>
+#define ST_ASIO_DEFAULT_UNPACKER flexible_unpacker<std::string>
+//shared_buffer is (seemingly) copyable, so shared_broadcast_msg makes all sockets hold references of the same packed message.
+#elif 5 == PACKER_UNPACKER_TYPE
+#define ST_ASIO_HUGE_MSG
+#define ST_ASIO_MSG_BUFFER_SIZE 65536 //the size of each slab
+#define ST_ASIO_DEFAULT_UNPACKER slicing_unpacker
+//messages are views into slabs, the packer packs them (in send_msg) directly from slabs.
+#elif 6 == PACKER_UNPACKER_TYPE
+#define ST_ASIO_DEFAULT_PACKER varint_packer<>
+#define ST_ASIO_DEFAULT_UNPACKER varint_unpacker<>
 #endif
 //configuration
 
@@ -63,6 +100,9 @@ using namespace st_asio_wrapper::ext;
 #define INCREASE_THREAD	"increase thread"
 #define DECREASE_THREAD	"decrease thread"
 #define REFS			"refs"
+#define BROADCAST_BENCH	"broadcast bench"
+#define MEMORY_USAGE	"memory usage"
+#define SCAN_BENCH		"scan bench"
 
 //demonstrate how to use custom packer
 //under the default behavior, each tcp::socket has their own packer, and cause memory waste
@@ -70,6 +110,33 @@ using namespace st_asio_wrapper::ext;
 //notice: do not do this for unpacker, because unpacker has member variables and can't share each other
 boost::shared_ptr<ST_ASIO_DEFAULT_PACKER> global_packer = boost::make_shared<ST_ASIO_DEFAULT_PACKER>();
 
+//the former suffix searching of prefix_suffix_unpacker (memcmp at every position), used by the scan bench command
+const void* bytewise_memmem(const void* mem, size_t len, const void* sub_mem, size_t sub_len)
+{
+	for (size_t i = 0; i + sub_len <= len; ++i, mem = (const char*) mem + 1)
+		if (0 == memcmp(mem, sub_mem, sub_len))
+			return mem;
+
+	return NULL;
+}
+
+//lines end with "\r\n", return MBps, find_fun NULL means bytewise_memmem
+double scan_lines(const std::string& text, size_t times, unpacker_helper::find_byte_fun find_fun)
+{
+	size_t line_num = 0;
+	clock_t begin_time = clock();
+	for (size_t i = 0; i < times; ++i)
+		for (const char* next = text.data(), * end = next + text.size();; next += 2, ++line_num)
+			if (NULL == (next = (const char*) (NULL == find_fun ? bytewise_memmem(next, end - next, "\r\n", 2) :
+				unpacker_helper::memmem(next, end - next, "\r\n", 2, find_fun))))
+				break;
+	double used_time = (double) (clock() - begin_time) / CLOCKS_PER_SEC;
+
+	if (line_num != times * (text.size() / (text.find('\r') + 2)))
+		puts("scan bench error!");
+	return used_time > 0 ? text.size() * times / used_time / 1024 / 1024 : 0;
+}
+
 //demonstrate how to control the type of tcp::server_socket_base::server from template parameter
 class i_echo_server : public i_server
 {
@@ -89,6 +156,9 @@ public:
 
 #if 3 == PACKER_UNPACKER_TYPE
 		boost::dynamic_pointer_cast<ST_ASIO_DEFAULT_UNPACKER>(unpacker())->prefix_suffix("begin", "end");
+#endif
+#ifdef DISPATCH_LANE_NUM
+		dispatch_lanes(DISPATCH_LANE_NUM);
 #endif
 	}
 
@@ -107,6 +177,28 @@ protected:
 		super::on_recv_error(ec);
 	}
 
+#ifdef SLOW_MSG_FILL
+	//simulate slow business, echo_client puts a sequence number (size_t) at the beginning of each msg, and fills the rest with msg_fill.
+	//start an echo_client with one link sending such messages (msg_fill is SLOW_MSG_FILL), then start another echo_client to do a normal test,
+	// compare the latter's TPS with and without macro HANDLER_POOL_THREAD_NUM.
+	static void handle_slowly(out_msg_ctype& msg)
+		{if (msg.size() > sizeof(size_t) && SLOW_MSG_FILL == msg.data()[sizeof(size_t)]) boost::this_thread::sleep_for(boost::chrono::milliseconds(10));}
+#endif
+
+#ifdef DISPATCH_LANE_NUM
+	//treat the sequence number as the key of a multiplexed stream, then messages are dispatched in DISPATCH_LANE_NUM lanes concurrently,
+	// echoes of different keys may be disordered, so test it with echo_client's random mode (which doesn't check the sequence),
+	// for example, one link with a slow business (msg_fill is SLOW_MSG_FILL), compare the TPS with and without this macro.
+	virtual size_t dispatch_key(out_msg_ctype& msg)
+	{
+		size_t key = 0;
+		if (msg.size() >= sizeof(size_t))
+			memcpy(&key, msg.data(), sizeof(size_t));
+
+		return key;
+	}
+#endif
+
 	//msg handling: send the original msg back(echo server)
 #ifdef ST_ASIO_SYNC_DISPATCH //do not open this feature
 	//do not hold msg_can for further usage, return from on_msg as quickly as possible
@@ -143,6 +235,9 @@ protected:
 		out_container_type tmp_can;
 		msg_can.move_items_out(tmp_can, 10); //don't be too greedy, here is in a service thread, we should not block this thread for a long time
 
+#ifdef SLOW_MSG_FILL
+		st_asio_wrapper::do_something_to_all(tmp_can, &echo_socket::handle_slowly);
+#endif
 		//following statement can avoid one memory replication if the type of out_msg_type and in_msg_type are identical.
 		for (BOOST_AUTO(iter, tmp_can.begin()); iter != tmp_can.end(); ++iter) send_msg(*iter, true);
 		return tmp_can.size();
@@ -151,7 +246,11 @@ protected:
 	}
 #else
 	//following statement can avoid one memory replication if the type of out_msg_type and in_msg_type are identical.
+#ifdef SLOW_MSG_FILL
+	virtual bool on_msg_handle(out_msg_type& msg) {handle_slowly(msg); return send_msg(msg);}
+#else
 	virtual bool on_msg_handle(out_msg_type& msg) {return send_msg(msg);}
+#endif
 #endif
 	//msg handling end
 };
@@ -276,17 +375,36 @@ int main(int argc, const char* argv[])
 	tt.start();
 	context.run();
 */
+	int thread_num = 1;
+	if (argc > 1)
+		thread_num = std::min(16, std::max(thread_num, atoi(argv[1])));
+
+#ifdef HANDLER_POOL_THREAD_NUM
+	handler_pool dis_pool; //sockets dispatch messages in it, so it must outlive the service_pump and the echo server (declare it before them)
+#endif
 	service_pump sp;
 #ifndef ST_ASIO_DECREASE_THREAD_AT_RUNTIME
 	//if you want to decrease service thread at runtime, then you cannot use multiple io_context, if somebody indeed needs it, please let me know.
 	//with multiple io_context, the number of service thread must be bigger than or equal to the number of io_context, please note.
 	//with multiple io_context, please also define macro ST_ASIO_AVOID_AUTO_STOP_SERVICE.
+#ifdef THREAD_PER_CORE
+	//with thread-per-core mode, the echo server (and all of its sockets) will be served by thread_num pinned threads, one io_context per thread.
+	std::vector<int> cpus;
+	for (int i = 0; i < thread_num; ++i)
+		cpus.push_back(i % (int) boost::thread::hardware_concurrency());
+	sp.set_thread_per_core(cpus);
+#else
 	sp.set_io_context_num(4);
+#endif
 #endif
 	echo_server echo_server_(sp); //echo server
 	echo_server_.add_io_context_refs(1); //the acceptor takes 2 references on the io_context that assigned to it.
 	((timer<executor>&) echo_server_).add_io_context_refs(1); //the timer object in server_base takes 2 references on the io_context that assigned to it.
 	dump_io_context_refs(sp);
+#ifdef HANDLER_POOL_THREAD_NUM
+	echo_server_.set_handler_pool(&dis_pool);
+	dis_pool.start(HANDLER_POOL_THREAD_NUM);
+#endif
 
 	//demonstrate how to use single_service_pump
 	//because of normal_socket, this server cannot support fixed_length_packer/fixed_length_unpacker and prefix_suffix_packer/prefix_suffix_unpacker,
@@ -310,10 +428,6 @@ int main(int argc, const char* argv[])
 	short_server.set_server_addr(port + 200, ip);
 	echo_server_.set_server_addr(port, ip);
 
-	int thread_num = 1;
-	if (argc > 1)
-		thread_num = std::min(16, std::max(thread_num, atoi(argv[1])));
-
 #if 3 == PACKER_UNPACKER_TYPE
 	global_packer->prefix_suffix("begin", "end");
 #endif
@@ -350,6 +464,9 @@ int main(int argc, const char* argv[])
 			statistic this_stat = echo_server_.get_statistic();
 			puts((this_stat - last_stat).to_string().data());
 			last_stat = this_stat;
+#ifdef ST_ASIO_BUFFER_BUDGET
+			printf("buffer budget usage: " ST_ASIO_SF " / " ST_ASIO_SF "\n", buffer_budget::usage(), buffer_budget::limit());
+#endif
 		}
 		else if (STATUS == str)
 		{
@@ -363,6 +480,74 @@ int main(int argc, const char* argv[])
 			puts("clients from echo server:");
 			echo_server_.list_all_object();
 		}
+		else if (BROADCAST_BENCH == str)
+		{
+			//compare broadcast_msg (pack msg for each link) with shared_broadcast_msg (pack msg only once), connect some links to the echo server
+			// without sending messages first (for example, start echo_client with -c and then do nothing), and run this with different link numbers.
+			//the cpu time is the whole process' (include sending), so do it on an idle server.
+			const int broadcast_num = 100;
+			std::string msg(256, '0');
+
+			clock_t begin_time = clock();
+			for (int i = 0; i < broadcast_num; ++i)
+				echo_server_.broadcast_msg(msg, true);
+			double per_socket_packing = (double) (clock() - begin_time) / CLOCKS_PER_SEC * 1000000 / broadcast_num;
+
+			begin_time = clock();
+			for (int i = 0; i < broadcast_num; ++i)
+				echo_server_.shared_broadcast_msg(msg, true);
+			double packing_once = (double) (clock() - begin_time) / CLOCKS_PER_SEC * 1000000 / broadcast_num;
+
+			printf("subscribers: " ST_ASIO_SF ", cpu time per broadcast: broadcast_msg %.1f us, shared_broadcast_msg %.1f us\n",
+				echo_server_.size(), per_socket_packing, packing_once);
+		}
+		else if (MEMORY_USAGE == str)
+		{
+			//measure memory occupation per idle link, connect some links to the echo server without sending messages (for example,
+			// start echo_client with a big link number and then do nothing), run this, then add more links and run this again.
+			//compare PACKER_UNPACKER_TYPE 5 with and without macro ST_ASIO_LAZY_RECV_BUFFER.
+			static size_t last_rss = 0, last_link_num = 0;
+			size_t rss = 0, link_num = echo_server_.size();
+			std::ifstream status("/proc/self/status"); //linux only
+			for (std::string line; std::getline(status, line);)
+				if (0 == line.compare(0, 6, "VmRSS:"))
+					rss = (size_t) atol(line.data() + 6); //KB
+
+			if (0 == rss)
+				puts("memory usage is only available on linux.");
+			else
+			{
+				printf("links: " ST_ASIO_SF ", rss: " ST_ASIO_SF " KB", link_num, rss);
+				if (link_num > last_link_num && last_link_num > 0)
+					printf(", memory per newly added link: %.1f KB", (double) ((boost::int_fast64_t) rss - (boost::int_fast64_t) last_rss) / (link_num - last_link_num));
+				putchar('\n');
+
+				last_rss = rss;
+				last_link_num = link_num;
+			}
+		}
+		else if (SCAN_BENCH == str)
+		{
+			//compare the suffix searching of prefix_suffix_unpacker (former bytewise memcmp, scalar and simd first byte searching) on line-oriented text.
+			const size_t text_len = 1024 * 1024;
+			const size_t line_lens[] = {16, 80, 1000};
+			for (size_t i = 0; i < sizeof(line_lens) / sizeof(line_lens[0]); ++i)
+			{
+				std::string line(line_lens[i] - 2, 'a'), text;
+				line += "\r\n";
+				while (text.size() + line.size() <= text_len)
+					text += line;
+
+				printf("line length " ST_ASIO_SF ", MBps: bytewise %.0f, scalar %.0f", line_lens[i], scan_lines(text, 50, NULL),
+					scan_lines(text, 50, &unpacker_helper::find_byte_scalar));
+#ifdef ST_ASIO_SIMD_SCAN
+				printf(", sse2 %.0f", scan_lines(text, 50, &unpacker_helper::find_byte_sse2));
+				if (unpacker_helper::has_avx2())
+					printf(", avx2 %.0f", scan_lines(text, 50, &unpacker_helper::find_byte_avx2));
+#endif
+				putchar('\n');
+			}
+		}
 		else if (INCREASE_THREAD == str)
 			sp.add_service_thread(1);
 #ifdef ST_ASIO_DECREASE_THREAD_AT_RUNTIME
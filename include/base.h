@@ -29,6 +29,7 @@
 #include <boost/bind/bind.hpp>
 #include <boost/typeof/typeof.hpp>
 #include <boost/container/list.hpp>
+#include <boost/container/deque.hpp>
 #include <boost/lambda/lambda.hpp>
 #include <boost/lambda/bind.hpp>
 #include <boost/lambda/if.hpp>
@@ -38,6 +39,14 @@
 
 #include "config.h"
 
+#ifdef ST_ASIO_TSC_CLOCK
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
 namespace st_asio_wrapper
 {
 
@@ -113,6 +122,88 @@ private:
 	atomic_flag& atomic;
 };
 
+#ifdef ST_ASIO_BUFFER_BUDGET
+//process-wide budget of all sockets' send and recv buffers, see macro ST_ASIO_BUFFER_BUDGET for more details.
+//a template just for defining static members in this header.
+template<int Dummy> class buffer_budget_t
+{
+public:
+	static void limit(size_t limit_) {_limit.store(limit_, boost::memory_order_relaxed);}
+	static size_t limit() {return _limit.load(boost::memory_order_relaxed);}
+	static size_t usage() {return (size_t) _usage.load(boost::memory_order_relaxed);}
+	static bool is_available() {return usage() < limit();}
+
+	//delta can be negative, unsigned arithmetic wraps around correctly.
+	static void charge(boost::int_fast64_t delta) {if (0 != delta) _usage.fetch_add((boost::uint_fast64_t) delta, boost::memory_order_relaxed);}
+
+private:
+	static atomic_size_t _limit;
+	static atomic_uint_fast64 _usage;
+};
+template<int Dummy> atomic_size_t buffer_budget_t<Dummy>::_limit(ST_ASIO_BUFFER_BUDGET);
+template<int Dummy> atomic_uint_fast64 buffer_budget_t<Dummy>::_usage(0);
+typedef buffer_budget_t<0> buffer_budget;
+#endif
+
+#ifdef ST_ASIO_COARSE_CLOCK
+//a cached time(NULL), see macro ST_ASIO_COARSE_CLOCK for more details.
+//service_pump starts the ticker when it starts, and stops it when it ends (the last one).
+//a template just for defining static members in this header.
+template<int Dummy> class coarse_clock_t
+{
+public:
+	static time_t now() {time_t t = (time_t) _now.load(boost::memory_order_relaxed); return 0 == t ? time(NULL) : t;} //0 means the ticker is not running
+
+	static void start()
+	{
+		boost::lock_guard<boost::mutex> lock(ticker_mutex);
+		if (0 == refs++)
+		{
+			_now.store((boost::uint_fast64_t) time(NULL), boost::memory_order_relaxed);
+			ticker = new boost::thread(&coarse_clock_t::tick);
+		}
+	}
+
+	static void stop()
+	{
+		boost::lock_guard<boost::mutex> lock(ticker_mutex);
+		if (refs > 0 && 0 == --refs)
+		{
+			ticker->interrupt();
+			ticker->join();
+			delete ticker;
+			ticker = NULL;
+			_now.store(0, boost::memory_order_relaxed);
+		}
+	}
+
+private:
+	static void tick()
+	{
+		try
+		{
+			while (true)
+			{
+				boost::this_thread::sleep_for(boost::chrono::milliseconds(ST_ASIO_COARSE_CLOCK));
+				_now.store((boost::uint_fast64_t) time(NULL), boost::memory_order_relaxed);
+			}
+		}
+		catch (const boost::thread_interrupted&) {}
+	}
+
+private:
+	static atomic_uint_fast64 _now;
+	static unsigned refs;
+	static boost::thread* ticker;
+	static boost::mutex ticker_mutex;
+};
+template<int Dummy> atomic_uint_fast64 coarse_clock_t<Dummy>::_now(0);
+template<int Dummy> unsigned coarse_clock_t<Dummy>::refs = 0;
+template<int Dummy> boost::thread* coarse_clock_t<Dummy>::ticker = NULL;
+template<int Dummy> boost::mutex coarse_clock_t<Dummy>::ticker_mutex;
+typedef coarse_clock_t<0> coarse_clock;
+#endif
+
 class tracked_executor;
 class service_pump;
 class i_matrix
@@ -195,11 +286,155 @@ public:
 	shared_buffer(T* _buffer) : object_buffer<boost::shared_ptr, T>(_buffer) {}
 };
 
+//free lists for memory blocks of the same size (Size), each thread caches at most ST_ASIO_NODE_POOL_CACHE blocks, half of them will be
+//given back to a global pool (a mutex guarded batch list) when exceeded, and a batch will be fetched from the global pool when the cache is empty,
+//so blocks allocated in one thread (for example, when sending messages) and freed in another thread (the io thread) can still be recycled.
+template<size_t Size> class node_pool
+{
+public:
+	static void* allocate()
+	{
+		cache& c = get_cache();
+		if (NULL == c.head)
+			fetch_batch(c);
+		if (NULL == c.head)
+			return ::operator new(block_size());
+
+		free_node* node = c.head;
+		c.head = node->next;
+		--c.num;
+		return node;
+	}
+
+	static void deallocate(void* p)
+	{
+		cache& c = get_cache();
+		free_node* node = (free_node*) p;
+		node->next = c.head;
+		c.head = node;
+		if (++c.num >= ST_ASIO_NODE_POOL_CACHE)
+			give_back_batch(c);
+	}
+
+private:
+	struct free_node {free_node* next;};
+	struct cache
+	{
+		free_node* head;
+		size_t num;
+
+		cache() : head(NULL), num(0) {}
+		~cache() {free_batch(head);}
+	};
+
+	static size_t block_size() {return Size > sizeof(free_node) ? Size : sizeof(free_node);}
+	static size_t batch_size() {return ST_ASIO_NODE_POOL_CACHE / 2 > 0 ? ST_ASIO_NODE_POOL_CACHE / 2 : 1;}
+	static cache& get_cache() {cache* c = caches.get(); if (NULL == c) caches.reset(c = new cache()); return *c;}
+	static void free_batch(free_node* node) {while (NULL != node) {free_node* next = node->next; ::operator delete(node); node = next;}}
+
+	static void fetch_batch(cache& c)
+	{
+		boost::lock_guard<boost::mutex> lock(global_mutex);
+		if (!global_batches.empty())
+		{
+			c.head = global_batches.back();
+			c.num = batch_size();
+			global_batches.pop_back();
+		}
+	}
+
+	static void give_back_batch(cache& c)
+	{
+		free_node* batch = c.head, * last = c.head;
+		for (size_t i = 1; i < batch_size(); ++i)
+			last = last->next;
+		c.head = last->next;
+		c.num -= batch_size();
+		last->next = NULL;
+
+		{
+			boost::lock_guard<boost::mutex> lock(global_mutex);
+			if (global_batches.size() < 64) //don't let the global pool grow without limitation
+			{
+				global_batches.push_back(batch);
+				return;
+			}
+		}
+		free_batch(batch);
+	}
+
+private:
+	static boost::thread_specific_ptr<cache> caches;
+	static boost::mutex global_mutex;
+	//each batch holds batch_size() blocks, at most 64 batches per Size. batches are intentionally never freed (they're still reachable,
+	// so they are not leaks for memory checkers), because other threads may give back or fetch batches (via global_mutex) during exit,
+	// destroying them in the destructor of a static object would race with the destruction of global_mutex and other static objects.
+	static std::vector<free_node*> global_batches;
+};
+template<size_t Size> boost::thread_specific_ptr<typename node_pool<Size>::cache> node_pool<Size>::caches;
+template<size_t Size> boost::mutex node_pool<Size>::global_mutex;
+template<size_t Size> std::vector<typename node_pool<Size>::free_node*> node_pool<Size>::global_batches;
+
+//allocator that allocates single objects from node_pool (or another pool that has the same interface, see slab_pool), for node based
+// containers (like list) and allocate_shared only.
+template<typename T, template<size_t> class Pool = node_pool> class pooled_allocator
+{
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+	template<typename U> struct rebind {typedef pooled_allocator<U, Pool> other;};
+
+	pooled_allocator() {}
+	template<typename U> pooled_allocator(const pooled_allocator<U, Pool>&) {}
+
+	pointer allocate(size_type n, const void* = NULL) {return (pointer) (1 == n ? Pool<sizeof(T)>::allocate() : ::operator new(n * sizeof(T)));}
+	void deallocate(pointer p, size_type n) {if (1 == n) Pool<sizeof(T)>::deallocate(p); else ::operator delete(p);}
+	size_type max_size() const {return (size_type) -1 / sizeof(T);}
+
+	pointer address(reference x) const {return &x;}
+	const_pointer address(const_reference x) const {return &x;}
+};
+//stateless, so splice between containers is always okay
+template<typename T, typename U, template<size_t> class Pool> bool operator==(const pooled_allocator<T, Pool>&, const pooled_allocator<U, Pool>&) {return true;}
+template<typename T, typename U, template<size_t> class Pool> bool operator!=(const pooled_allocator<T, Pool>&, const pooled_allocator<U, Pool>&) {return false;}
+
+//same as list, but nodes are recycled by node_pool instead of being allocated and freed for every message.
+template<typename T> class pooled_list : public boost::container::list<T, pooled_allocator<T> >
+{
+private:
+	typedef boost::container::list<T, pooled_allocator<T> > super;
+
+public:
+	pooled_list() {}
+	pooled_list(size_t n) : super(n) {}
+
+#if BOOST_VERSION < 106200
+	using super::emplace_back;
+	typename super::reference emplace_back() {super::emplace_back(); return super::back();}
+	using super::emplace_front;
+	typename super::reference emplace_front() {super::emplace_front(); return super::front();}
+#endif
+};
+
 //st_asio_wrapper requires that container must take one and only one template argument
+//with macro ST_ASIO_POOLED_LIST, list is the same as pooled_list, this makes all temporary message containers (like the one passed to on_msg)
+// recycle their nodes too.
+#ifdef ST_ASIO_POOLED_LIST
+template<typename T> class list : public boost::container::list<T, pooled_allocator<T> >
+{
+private:
+	typedef boost::container::list<T, pooled_allocator<T> > super;
+#else
 template<typename T> class list : public boost::container::list<T>
 {
 private:
 	typedef boost::container::list<T> super;
+#endif
 
 public:
 	list() {}
@@ -213,6 +448,25 @@ public:
 #endif
 };
 
+//no splice, so it cannot be used by queue (and mpsc_queue), but it's a good output container for spsc_queue,
+//because it allocates memory by blocks instead of items.
+template<typename T> class deque : public boost::container::deque<T>
+{
+private:
+	typedef boost::container::deque<T> super;
+
+public:
+	deque() {}
+	deque(size_t n) : super(n) {}
+
+#if BOOST_VERSION < 106200
+	using super::emplace_back;
+	typename super::reference emplace_back() {super::emplace_back(); return super::back();}
+	using super::emplace_front;
+	typename super::reference emplace_front() {super::emplace_front(); return super::front();}
+#endif
+};
+
 //packer concept
 template<typename MsgType>
 class i_packer
@@ -283,6 +537,12 @@ public:
 	virtual void compose_msg(const char* data, size_t size, container_type& msg_can) {} //reliable UDP socket needs this
 	virtual size_t completion_condition(const boost::system::error_code& ec, size_t bytes_transferred) {return 0;}
 	virtual buffer_type prepare_next_recv() = 0;
+	//return true if no half-baked msg left and the receive buffer has been released (or no buffer needs to be held), then the socket will
+	// wait for readability before calling prepare_next_recv, see macro ST_ASIO_LAZY_RECV_BUFFER for more details.
+	virtual bool release_buffer() {return false;}
+	//side-effect-free pre-check of release_buffer, return false if release_buffer will surely return false, then the socket will not even
+	// check whether the link is idle (which costs a system call), so override both of them or neither.
+	virtual bool can_release_buffer() const {return false;}
 
 	//this default implementation is meaningless, just satisfy compilers
 	virtual char* raw_data(msg_type& msg) const {return const_cast<char*>(msg.data());}
@@ -331,6 +591,44 @@ namespace udp
 } //namespace
 //unpacker concept
 
+#ifdef ST_ASIO_TSC_CLOCK
+//a monotonic clock based on the time stamp counter, see macro ST_ASIO_TSC_CLOCK for more details.
+//a template just for defining static members in this header.
+template<int Dummy> struct tsc_clock_t
+{
+	typedef boost::chrono::system_clock::duration duration;
+	typedef typename duration::rep rep;
+	typedef typename duration::period period;
+	typedef boost::chrono::time_point<tsc_clock_t, duration> time_point;
+	static const bool is_steady = true;
+
+	static time_point now() {calibrate(); return time_point(duration((rep) ((double) __rdtsc() * ratio)));}
+
+	//blocks for about 20 milliseconds at the first time, service_pump calls it when it starts, so now() will not be blocked.
+	static void calibrate() {boost::call_once(calibrated, &do_calibrate);}
+
+private:
+	static void do_calibrate() {ratio = durations_per_tick();}
+	static double durations_per_tick()
+	{
+		BOOST_AUTO(begin_time, boost::chrono::steady_clock::now());
+		boost::uint64_t begin_tick = __rdtsc();
+		boost::this_thread::sleep_for(boost::chrono::milliseconds(20));
+		boost::uint64_t end_tick = __rdtsc();
+		BOOST_AUTO(end_time, boost::chrono::steady_clock::now());
+
+		return (double) boost::chrono::duration_cast<duration>(end_time - begin_time).count() / (end_tick - begin_tick);
+	}
+
+private:
+	static double ratio;
+	static boost::once_flag calibrated;
+};
+template<int Dummy> double tsc_clock_t<Dummy>::ratio = 0;
+template<int Dummy> boost::once_flag tsc_clock_t<Dummy>::calibrated = BOOST_ONCE_INIT;
+typedef tsc_clock_t<0> tsc_clock;
+#endif
+
 struct statistic
 {
 #ifdef ST_ASIO_FULL_STATISTIC
@@ -381,8 +679,13 @@ struct statistic
 		boost::int_fast64_t num;
 	};
 
+#ifdef ST_ASIO_TSC_CLOCK
+	typedef tsc_clock::time_point stat_time;
+	static stat_time now() {return tsc_clock::now();}
+#else
 	typedef boost::chrono::system_clock::time_point stat_time;
 	static stat_time now() {return boost::chrono::system_clock::now();}
+#endif
 	typedef duration stat_duration;
 #else
 	struct dummy_duration //not a real duration
@@ -398,10 +701,18 @@ struct statistic
 #endif
 	statistic() {reset_number();}
 
+	//time source of establish_time, break_time, last_send_time and last_recv_time, see macro ST_ASIO_COARSE_CLOCK for more details.
+#ifdef ST_ASIO_COARSE_CLOCK
+	static time_t time_now() {return coarse_clock::now();}
+#else
+	static time_t time_now() {return time(NULL);}
+#endif
+
 	void reset_number()
 	{
 		send_msg_sum = 0;
 		send_byte_sum = 0;
+		send_expired_sum = 0;
 
 		recv_msg_sum = 0;
 		recv_byte_sum = 0;
@@ -434,6 +745,7 @@ struct statistic
 	{
 		send_msg_sum += other.send_msg_sum;
 		send_byte_sum += other.send_byte_sum;
+		send_expired_sum += other.send_expired_sum;
 		send_delay_sum += other.send_delay_sum;
 		send_time_sum += other.send_time_sum;
 		pack_time_sum += other.pack_time_sum;
@@ -460,6 +772,7 @@ struct statistic
 	{
 		send_msg_sum -= other.send_msg_sum;
 		send_byte_sum -= other.send_byte_sum;
+		send_expired_sum -= other.send_expired_sum;
 		send_delay_sum -= other.send_delay_sum;
 		send_time_sum -= other.send_time_sum;
 		pack_time_sum -= other.pack_time_sum;
@@ -486,6 +799,9 @@ struct statistic
 	{
 		std::ostringstream s;
 		s << "send relevant statistic:\nmessage sum: " << send_msg_sum << std::endl << "size in bytes: " << send_byte_sum << std::endl
+#ifdef ST_ASIO_MSG_DEADLINE
+			<< "expired message sum: " << send_expired_sum << std::endl
+#endif
 #ifdef ST_ASIO_FULL_STATISTIC
 			<< "send delay: " << send_delay_sum << std::endl << "send duration: " << send_time_sum << std::endl << "pack duration: " << pack_time_sum << std::endl
 #endif
@@ -500,6 +816,7 @@ struct statistic
 	//send relevant statistic
 	boost::uint_fast64_t send_msg_sum; //not counted msgs in sending buffer
 	boost::uint_fast64_t send_byte_sum; //include data added by packer, not counted msgs in sending buffer
+	boost::uint_fast64_t send_expired_sum; //msgs discarded because of their deadlines, see macro ST_ASIO_MSG_DEADLINE
 	stat_duration send_delay_sum; //from send_(native_)msg (exclude msg packing) to boost::asio::async_write
 	stat_duration send_time_sum; //from boost::asio::async_write to send_handler
 	//above two items indicate your network's speed or load
@@ -548,19 +865,39 @@ template<typename T> struct obj_with_begin_time : public T
 	obj_with_begin_time(T& obj) {T::swap(obj); restart();} //after this call, obj becomes empty, please note.
 	obj_with_begin_time& operator=(const T& obj) {T::operator=(obj); restart(); return *this;}
 	obj_with_begin_time& operator=(T& obj) {T::clear(); T::swap(obj); restart(); return *this;} //after this call, obj becomes empty, please note.
+#ifdef ST_ASIO_MSG_DEADLINE
+	obj_with_begin_time(const obj_with_begin_time& other) : T(other), begin_time(other.begin_time), deadline(other.deadline) {}
+#else
 	obj_with_begin_time(const obj_with_begin_time& other) : T(other), begin_time(other.begin_time) {}
+#endif
 	obj_with_begin_time(obj_with_begin_time& other) {swap(other);} //after this call, other becomes empty, please note.
+#ifdef ST_ASIO_MSG_DEADLINE
+	obj_with_begin_time& operator=(const obj_with_begin_time& other) {T::operator=(other); begin_time = other.begin_time; deadline = other.deadline; return *this;}
+#else
 	obj_with_begin_time& operator=(const obj_with_begin_time& other) {T::operator=(other); begin_time = other.begin_time; return *this;}
+#endif
 	obj_with_begin_time& operator=(obj_with_begin_time& other) {clear(); swap(other);} //after this call, other becomes empty, please note.
 
 	void restart() {restart(statistic::now());}
 	void restart(const typename statistic::stat_time& begin_time_) {begin_time = begin_time_;}
 	void swap(T& obj) {T::swap(obj); restart();}
+#ifdef ST_ASIO_MSG_DEADLINE
+	void swap(obj_with_begin_time& other) {T::swap(other); std::swap(begin_time, other.begin_time); std::swap(deadline, other.deadline);}
+
+	void clear() {T::clear(); begin_time = typename statistic::stat_time(); deadline = deadline_type();}
+
+	typedef boost::chrono::steady_clock::time_point deadline_type;
+	bool expired(const deadline_type& now) const {return deadline_type() != deadline && deadline <= now;}
+#else
 	void swap(obj_with_begin_time& other) {T::swap(other); std::swap(begin_time, other.begin_time);}
 
 	void clear() {T::clear(); begin_time = typename statistic::stat_time();}
+#endif
 
 	typename statistic::stat_time begin_time;
+#ifdef ST_ASIO_MSG_DEADLINE
+	deadline_type deadline; //default value (the epoch of steady_clock) means never expire
+#endif
 };
 #ifdef _MSC_VER
 #pragma warning(pop)
@@ -585,6 +922,16 @@ public:
 #pragma warning(disable:4521)
 #pragma warning(disable:4522)
 #endif
+//boost::promise with an optional callback, which will be invoked right after the result been set (in the thread which sets the result),
+// then the sending result can be waited asynchronously, see TCP_ASYNC_SEND_MSG.
+class sync_promise : public boost::promise<sync_call_result>
+{
+public:
+	void set_value(sync_call_result re) {boost::promise<sync_call_result>::set_value(re); if (callback) callback(re);}
+
+	boost::function<void(sync_call_result)> callback;
+};
+
 template<typename T> struct obj_with_begin_time_promise : public obj_with_begin_time<T>
 {
 #ifndef BOOST_THREAD_FUTURE
@@ -605,9 +952,9 @@ template<typename T> struct obj_with_begin_time_promise : public obj_with_begin_
 	void swap(obj_with_begin_time_promise& other) {super::swap(other); p.swap(other.p);}
 
 	void clear() {super::clear(); p.reset();}
-	void check_and_create_promise(bool need_promise) {if (!need_promise) p.reset(); else if (!p) p = boost::make_shared<boost::promise<sync_call_result> >();}
+	void check_and_create_promise(bool need_promise) {if (!need_promise) p.reset(); else if (!p) p = boost::make_shared<sync_promise>();}
 
-	boost::shared_ptr<boost::promise<sync_call_result> > p;
+	boost::shared_ptr<sync_promise> p;
 };
 #ifdef _MSC_VER
 #pragma warning(pop)
@@ -692,6 +1039,11 @@ template<typename _Predicate> void NAME(const _Predicate& __pred) const {for (BO
 #define POP_ALL_PENDING_MSG_NOTIFY(FUNNAME, CAN, CANTYPE) void FUNNAME(CANTYPE& can) \
 	{can.clear(); CAN.swap(can); for (BOOST_AUTO(iter, can.begin()); iter != can.end(); ++iter) if (iter->p) iter->p->set_value(NOT_APPLICABLE);}
 
+//used by TCP_PARALLEL_DIRECT_BROADCAST_MSG
+template<typename Socket, typename Msg>
+bool direct_send_shared_msg(const boost::shared_ptr<Socket>& socket_ptr, const boost::shared_ptr<Msg>& msg, bool can_overflow, bool prior)
+	{return socket_ptr->direct_send_msg((const Msg&) *msg, can_overflow, prior);}
+
 ///////////////////////////////////////////////////
 //TCP msg sending interface
 #define TCP_SEND_MSG_CALL_SWITCH(FUNNAME, TYPE) \
@@ -779,6 +1131,40 @@ bool FUNNAME(const char* const pstr[], const size_t len[], size_t num, bool can_
 } \
 TCP_SEND_MSG_CALL_SWITCH(FUNNAME, bool)
 
+//put the msg into the specified lane of send buffer, only available if input queue is lane_queue (see ST_ASIO_INPUT_QUEUE)
+#define TCP_SEND_MSG_IN_LANE(FUNNAME, NATIVE) \
+bool FUNNAME(size_t lane, const char* const pstr[], const size_t len[], size_t num, bool can_overflow = false, bool prior = false) \
+{ \
+	if (!can_overflow && !ST_THIS shrink_send_buffer()) \
+		return false; \
+	auto_duration dur(stat.pack_time_sum); \
+	in_msg_type msg; \
+	ST_THIS packer()->pack_msg(msg, pstr, len, num, NATIVE); \
+	dur.end(); \
+	return ST_THIS do_direct_send_msg_in_lane(lane, msg, prior); \
+} \
+bool FUNNAME(size_t lane, const char* pstr, size_t len, bool can_overflow = false, bool prior = false) {return FUNNAME(lane, &pstr, &len, 1, can_overflow, prior);} \
+template<typename Buffer> \
+bool FUNNAME(size_t lane, const Buffer& buffer, bool can_overflow = false, bool prior = false) {return FUNNAME(lane, buffer.data(), buffer.size(), can_overflow, prior);}
+
+//put the msg into send buffer with a deadline, only available if macro ST_ASIO_MSG_DEADLINE been defined
+#define TCP_SEND_MSG_BEFORE(FUNNAME, NATIVE) \
+bool FUNNAME(const msg_deadline& deadline, const char* const pstr[], const size_t len[], size_t num, bool can_overflow = false, bool prior = false) \
+{ \
+	if (!can_overflow && !ST_THIS shrink_send_buffer()) \
+		return false; \
+	auto_duration dur(stat.pack_time_sum); \
+	in_msg_type msg; \
+	ST_THIS packer()->pack_msg(msg, pstr, len, num, NATIVE); \
+	dur.end(); \
+	return ST_THIS do_direct_send_msg_before(deadline, msg, prior); \
+} \
+bool FUNNAME(const msg_deadline& deadline, const char* pstr, size_t len, bool can_overflow = false, bool prior = false) \
+	{return FUNNAME(deadline, &pstr, &len, 1, can_overflow, prior);} \
+template<typename Buffer> \
+bool FUNNAME(const msg_deadline& deadline, const Buffer& buffer, bool can_overflow = false, bool prior = false) \
+	{return FUNNAME(deadline, buffer.data(), buffer.size(), can_overflow, prior);}
+
 //guarantee send msg successfully even if can_overflow equal to false, success at here just means putting the msg into tcp::socket_base's send buffer successfully
 //if can_overflow equal to false and the buffer is not available, will wait until it becomes available
 #define TCP_SAFE_SEND_MSG(FUNNAME, SEND_FUNNAME) \
@@ -807,6 +1193,31 @@ void FUNNAME(const char* const pstr[], const size_t len[], size_t num, bool can_
 	{ST_THIS do_something_to_all(boost::bind((bool (Socket::*)(const char* const[], const size_t[], size_t, bool, bool)) &Socket::SEND_FUNNAME, \
 		boost::placeholders::_1, pstr, len, num, can_overflow, prior));} \
 TCP_SEND_MSG_CALL_SWITCH(FUNNAME, void)
+
+//put a packed msg into all sockets' send buffers, if the msg type is cheaply copyable (like shared_buffer, see packer2), all sockets just
+// hold references of the same immutable buffer, otherwise, msg will be copied for each socket.
+#define TCP_DIRECT_BROADCAST_MSG(FUNNAME) \
+void FUNNAME(typename Pool::in_msg_ctype& msg, bool can_overflow = false, bool prior = false) \
+	{ST_THIS do_something_to_all(boost::bind((bool (Socket::*)(typename Pool::in_msg_ctype&, bool, bool)) &Socket::direct_send_msg, \
+		boost::placeholders::_1, boost::cref(msg), can_overflow, prior));}
+
+//unlike TCP_BROADCAST_MSG, pack the msg only once (with a default constructed packer of Socket::packer_type), then broadcast it via DIRECT_FUNNAME,
+// so all sockets must use the same protocol, if your packer needs initialization (like prefix_suffix_packer), pack msg yourself and call DIRECT_FUNNAME.
+#define TCP_SHARED_BROADCAST_MSG(FUNNAME, DIRECT_FUNNAME, NATIVE) \
+void FUNNAME(const char* const pstr[], const size_t len[], size_t num, bool can_overflow = false, bool prior = false) \
+{ \
+	typename Socket::packer_type packer_; \
+	typename Pool::in_msg_type msg; \
+	if (packer_.pack_msg(msg, pstr, len, num, NATIVE)) \
+		DIRECT_FUNNAME(msg, can_overflow, prior); \
+} \
+TCP_SEND_MSG_CALL_SWITCH(FUNNAME, void)
+
+//like TCP_DIRECT_BROADCAST_MSG, but via object_pool::do_something_to_all_in_parallel, msg will be copied once and shared by all fan-out tasks.
+#define TCP_PARALLEL_DIRECT_BROADCAST_MSG(FUNNAME) \
+void FUNNAME(typename Pool::in_msg_ctype& msg, bool can_overflow = false, bool prior = false) \
+	{ST_THIS do_something_to_all_in_parallel(boost::bind(&st_asio_wrapper::direct_send_shared_msg<Socket, typename Pool::in_msg_type>, \
+		boost::placeholders::_1, boost::make_shared<typename Pool::in_msg_type>(msg), can_overflow, prior));}
 //TCP msg sending interface
 ///////////////////////////////////////////////////
 
@@ -900,6 +1311,26 @@ sync_call_result FUNNAME(const char* const pstr[], const size_t len[], size_t nu
 } \
 TCP_SYNC_SEND_MSG_CALL_SWITCH(FUNNAME, sync_call_result)
 
+//like TCP_SYNC_SEND_MSG, but don't wait, callback will be invoked with the result after the msg been sent (SUCCESS) or discarded (NOT_APPLICABLE),
+// in the thread which sent or discarded the msg, return false means the msg has not been put into the send buffer (and callback will never be invoked).
+#define TCP_ASYNC_SEND_MSG(FUNNAME, NATIVE) \
+bool FUNNAME(const char* const pstr[], const size_t len[], size_t num, const boost::function<void(sync_call_result)>& callback, \
+	bool can_overflow = false, bool prior = false) \
+{ \
+	if (!can_overflow && !ST_THIS shrink_send_buffer()) \
+		return false; \
+	auto_duration dur(stat.pack_time_sum); \
+	in_msg_type msg; \
+	ST_THIS packer()->pack_msg(msg, pstr, len, num, NATIVE); \
+	dur.end(); \
+	return do_direct_async_send_msg(msg, callback, prior); \
+} \
+bool FUNNAME(const char* pstr, size_t len, const boost::function<void(sync_call_result)>& callback, bool can_overflow = false, bool prior = false) \
+	{return FUNNAME(&pstr, &len, 1, callback, can_overflow, prior);} \
+template<typename Buffer> \
+bool FUNNAME(const Buffer& buffer, const boost::function<void(sync_call_result)>& callback, bool can_overflow = false, bool prior = false) \
+	{return FUNNAME(buffer.data(), buffer.size(), callback, can_overflow, prior);}
+
 //guarantee send msg successfully even if can_overflow equal to false, success at here just means putting the msg into tcp::socket_base's send buffer successfully
 //if can_overflow equal to false and the buffer is not available, will wait until it becomes available
 #define TCP_SYNC_SAFE_SEND_MSG(FUNNAME, SEND_FUNNAME) \
@@ -914,10 +914,58 @@
  * Macro ST_ASIO_CAN_EMPTY_NOT_SAFE and ST_ASIO_ARBITRARY_SEND are removed, then your queue must provide 'is_empty' function.
  *
  * HIGHLIGHT:
+ * Add lock-free multi-producer / single-consumer queue mpsc_queue, it can be used as input queue (via macro ST_ASIO_INPUT_QUEUE).
+ * Add wait-free single-producer / single-consumer queue spsc_queue, it can be used as output queue (via macro ST_ASIO_OUTPUT_QUEUE).
+ * Add container deque, it can be used together with spsc_queue (via macro ST_ASIO_OUTPUT_CONTAINER).
+ * Add container pooled_list, it recycles nodes via per-thread free lists, can be used as input and / or output container
+ *  (via macro ST_ASIO_INPUT_CONTAINER and ST_ASIO_OUTPUT_CONTAINER).
+ * Add multi-lane queue lane_queue, it can be used as input queue (via macro ST_ASIO_INPUT_QUEUE), lanes are drained with weighted round-robin
+ *  or strict priority, and share one send buffer budget, see socket::direct_send_msg_in_lane and tcp::socket_base::send_msg_in_lane.
+ * Support deadlines of messages in send buffer, expired messages will be discarded rather than being sent, see macro ST_ASIO_MSG_DEADLINE for more details.
+ * Add direct_broadcast_msg, shared_broadcast_msg and shared_broadcast_native_msg to tcp::server_base and tcp::multi_client_base, they pack messages
+ *  only once, with shared_buffer (see packer2), all sockets hold references of the same packed message.
+ * Add ring buffer unpacker ring_unpacker (protocol: length + body), it never moves leftover data and returns real scatter-gather buffers
+ *  from prepare_next_recv, only available with macro ST_ASIO_SCATTERED_RECV_BUFFER.
+ * Add zero-copy unpacker slicing_unpacker (protocol: length + body) and its message type slab_buffer, messages are views into shared slabs
+ *  which will be recycled (via slab_pool) after all messages sliced from them have been released.
+ * Add object_pool::do_something_to_all_in_parallel, it only holds the pool lock during taking a snapshot, and then runs one task per io_context.
+ * Add parallel_direct_broadcast_msg, parallel_broadcast_msg and parallel_broadcast_native_msg to tcp::server_base and tcp::multi_client_base,
+ *  see object_pool::do_something_to_all_in_parallel for more details.
+ * Add varint_packer and varint_unpacker (protocol: varint length + body), messages shorter than 128 bytes only pay one byte for the header,
+ *  see varint_header for more details.
+ * Add handler_pool, it dispatches messages (on_msg_handle etc.) in its own threads rather than in service threads, messages of the same socket
+ *  are still dispatched in sequence, see object_pool::set_handler_pool and socket::set_dispatch_io_context.
+ * Add dispatch lanes, messages of one socket can be dispatched concurrently in several lanes, while messages which have the same key
+ *  (see socket::dispatch_key) are still dispatched in sequence, see socket::dispatch_lanes for more details.
+ * Add coroutine_socket (C++20), connect, send_msg and recv_msg can be awaited with co_await, no threads will be blocked,
+ *  see tcp/coroutine_socket.h and demo coroutine_client for more details.
+ * Add thread-per-core mode to service_pump, one io_context (concurrency hint 1) per cpu, service threads are pinned to their cpus and
+ *  prefer their local NUMA nodes, tcp sockets re-create their unpackers (receive buffers) in their own service threads,
+ *  see service_pump::set_thread_per_core, socket::localize_unpacker and demo echo_server (macro THREAD_PER_CORE) for more details.
+ * Add single-threaded io_context policy, strands become plain executors, queues default to non_lock_queue and flags only changed
+ *  in service threads drop their read-modify-write, see macro ST_ASIO_SINGLE_THREAD_CONTEXT for more details.
  *
  * FIX:
  *
  * ENHANCEMENTS:
+ * Support coalescing small messages into one buffer before sending (tcp only), see macro ST_ASIO_SEND_COALESCE_SIZE for more details.
+ * Support holding messages for a while on idle sockets to send more messages at a time (software cork), see macro ST_ASIO_SEND_WINDOW for more details.
+ * Add timer::set_timer with a strand, the call_back of the timer will be called in that strand.
+ * Support sending big messages with MSG_ZEROCOPY on linux (tcp only), see macro ST_ASIO_ZEROCOPY for more details.
+ * Support limiting the sum of all sockets' send and recv buffers, see macro ST_ASIO_BUFFER_BUDGET for more details.
+ * Support borrowing receive buffers only when data arrived (tcp only), see macro ST_ASIO_LAZY_RECV_BUFFER for more details.
+ * Stopped receiving (because of overflowed recv buffer) will be resumed by the dispatcher right after the recv buffer dropped to the low watermark
+ *  instead of being checked by a timer, see macro ST_ASIO_RECV_LOW_WATERMARK for more details.
+ * Add socket::resume_dispatch() to re-dispatch messages immediately after on_msg_handle failed, see macro ST_ASIO_MSG_HANDLING_INTERVAL for more details.
+ * prefix_suffix_unpacker searches suffix with SSE2 or AVX2 (chosen at runtime), see macro ST_ASIO_NO_SIMD_SCAN for more details.
+ * Support caching time(NULL) for the timestamps in statistic (refreshed by a background ticker), see macro ST_ASIO_COARSE_CLOCK for more details.
+ * Support measuring time consumption with the time stamp counter if ST_ASIO_FULL_STATISTIC been defined, see macro ST_ASIO_TSC_CLOCK for more details.
+ * Add tcp::socket_base::async_send_msg and async_send_native_msg, they don't wait for the sending, but call back with the result (need macro ST_ASIO_SYNC_SEND).
+ * Messages discarded by shrink_send_buffer will notify their sync sending (NOT_APPLICABLE) if macro ST_ASIO_SYNC_SEND been defined.
+ * Completion handlers of the reading and writing are concrete types (no boost::function) with per-socket recycled memory (C++11 and boost 1.66
+ *  or higher), no heap allocations will happen during steady state reading and writing, see macro ST_ASIO_HANDLER_ALLOCATOR and demo allocation_test.
+ * Support recycling nodes of list (all temporary message containers) via node_pool, see macro ST_ASIO_POOLED_LIST for more details.
+ * Support tracking asynchronous calls with per-thread counters instead of a shared reference count, see macro ST_ASIO_PER_THREAD_ACI for more details.
  *
  * DELETION:
  * Delete macro ST_ASIO_CAN_EMPTY_NOT_SAFE and ST_ASIO_ARBITRARY_SEND, then your queue must provide 'is_empty' function,
@@ -926,6 +974,8 @@
  * REFACTORING:
  *
  * REPLACEMENTS:
+ * Replace macro ST_ASIO_MSG_RESUMING_INTERVAL, socket::msg_resuming_interval and timer TIMER_CHECK_RECV with macro ST_ASIO_RECV_LOW_WATERMARK,
+ *  the former ones are deprecated (they do nothing any more).
  *
  */
 
@@ -1059,6 +1109,58 @@
 	#error message capacity must be bigger than zero.
 #endif
 
+//#define ST_ASIO_BUFFER_BUDGET	(256 * 1024 * 1024) //256M
+//process-wide budget (bytes) of all sockets' send and recv buffers, ST_ASIO_MAX_SEND_BUF and ST_ASIO_MAX_RECV_BUF only limit one socket,
+// with a lot of sockets, the sum of them can still exhaust all virtual memory, this macro limits the sum.
+//if the budget ran out, send_msg and its variants will fail (unless can_overflow is true), and all sockets stop receiving messages except
+// sockets that have empty recv buffers (they don't hold any budget), stopped sockets will be resumed by their dispatchers, just like
+// overflowed recv buffers are (see ST_ASIO_RECV_LOW_WATERMARK).
+//the budget can be changed via st_asio_wrapper::buffer_budget::limit(size_t) at runtime, and the usage can be got via
+// st_asio_wrapper::buffer_budget::usage(), messages that are being sent or dispatched are not counted.
+#ifdef ST_ASIO_BUFFER_BUDGET
+	#if ST_ASIO_BUFFER_BUDGET <= 0
+		#error buffer budget must be bigger than zero.
+	#endif
+#endif
+
+//tcp only, messages smaller than this size (bytes) will be copied into a reused per-socket buffer before sending (adjacent ones become one buffer),
+// rather than one buffer per message (scatter-gather), this avoids huge iovec arrays when sending a lot of small messages, 0 means disabled.
+//bigger messages will still be sent via scatter-gather.
+#ifndef ST_ASIO_SEND_COALESCE_SIZE
+#define ST_ASIO_SEND_COALESCE_SIZE	0
+#elif ST_ASIO_SEND_COALESCE_SIZE < 0
+	#error coalescing size must be bigger than or equal to zero.
+#endif
+
+//linux only (kernel 4.14 or higher), tcp::socket_base sends big batches of messages with MSG_ZEROCOPY (ssl and websocket will just ignore it),
+// the kernel will not copy the data but refer to them until the completion arrives via the error queue, so before that, messages will be
+// held by tcp::socket_base, and on_msg_send, on_all_msg_send and sync_send_msg will be notified after the completion rather than after the sending.
+//if the kernel had to copy the data (loopback for example), zerocopy will be disabled on that connection.
+//#define ST_ASIO_ZEROCOPY
+#ifdef ST_ASIO_ZEROCOPY
+	#if !defined(__linux__) || BOOST_ASIO_VERSION < 101100
+		#error zerocopy needs linux and boost 1.66 or higher.
+	#endif
+
+	//batches (see batch_msg_send_size) which have at least this many bytes will be sent with MSG_ZEROCOPY,
+	// smaller batches are sent faster by copying, because of the page pinning and the completion notification.
+	#ifndef ST_ASIO_ZEROCOPY_SIZE
+	#define ST_ASIO_ZEROCOPY_SIZE	(16 * 1024)
+	#elif ST_ASIO_ZEROCOPY_SIZE <= 0
+		#error zerocopy size must be bigger than zero.
+	#endif
+#endif
+
+//tcp::socket_base waits for readability (async_wait) before asking the unpacker for a receive buffer if the link is idle (no received data
+// is pending, busy links just read directly) and the unpacker holds no half-baked msg and has released its buffer (see
+// i_unpacker::release_buffer), so unpackers which borrow buffers from a shared pool (like slicing_unpacker and non_copy_unpacker)
+// hold no memory on idle links, this is useful if you have a huge number of mostly idle links.
+//ssl and websocket will just ignore it, because they may hold received data in their own buffers.
+//#define ST_ASIO_LAZY_RECV_BUFFER
+#if defined(ST_ASIO_LAZY_RECV_BUFFER) && BOOST_ASIO_VERSION < 101100
+	#error lazy receive buffer needs boost 1.66 or higher.
+#endif
+
 //the message mode for websocket, !0 - binary mode (default), 0 - text mode
 #ifndef ST_ASIO_WEBSOCKET_BINARY
 #define ST_ASIO_WEBSOCKET_BINARY	1
@@ -1078,6 +1180,12 @@
 //    before send_msg returns, so most likely, it will be in your thread, this is unlike other callbacks, which will be called in service threads.
 //#define ST_ASIO_SHRINK_SEND_BUFFER
 
+//support deadlines of messages, messages which are still in the send buffer when their deadlines are reached will be discarded just before
+// sending rather than being sent, see send_msg_before, send_native_msg_before and direct_send_msg_before (only them can carry a deadline).
+//discarded messages will be passed to virtual function on_msg_discard (in service threads) and be counted in statistic::send_expired_sum.
+//please note that it costs one more time point in each message and one steady_clock::now() in each sending.
+//#define ST_ASIO_MSG_DEADLINE
+
 //buffer (on stack) size used when writing logs.
 #ifndef ST_ASIO_UNIFIED_OUT_BUF_NUM
 #define ST_ASIO_UNIFIED_OUT_BUF_NUM	2048
@@ -1106,9 +1214,108 @@
 	#error delay close duration must be bigger than or equal to zero.
 #endif
 
+//#define ST_ASIO_NO_HANDLER_ALLOCATOR
+//with c++11 and boost 1.66 or higher, completion handlers of the reading and writing are concrete types (boost::function and boost::lambda
+// are not used any more, see tracked_executor::make_handler_error_size), they provide asio the associated allocator (handler_allocator) which
+// allocates asio's operations from per-socket recycled memory (socket::reading_memory and socket::sending_memory, see handler_memory),
+// handlers posted via post, defer and dispatch (like post_in_io_strand) are concrete types too (asio recycles their memory in per-thread
+// caches), so no heap allocations will happen during steady state reading and writing, see demo allocation_test.
+//define this macro to use boost::function instead.
+//please note that the reading and writing of tcp sockets will be really executed in rw_strand as udp sockets do, with boost::function,
+// the strand was erased with its type.
+#if !defined(ST_ASIO_NO_HANDLER_ALLOCATOR) && BOOST_ASIO_VERSION >= 101100 && (defined(__GXX_EXPERIMENTAL_CXX0X__) || __cplusplus >= 201103L)
+	#define ST_ASIO_HANDLER_ALLOCATOR
+#endif
+
+//#define ST_ASIO_PER_THREAD_ACI
+//only available if ST_ASIO_DELAY_CLOSE equal to zero, use aci_counter instead of boost::shared_ptr<char> to track asynchronous calls,
+// each thread counts (monotonically) the handlers it created and destroyed in its own cache line, the counters will only be summed up
+// when is_async_calling and is_last_async_call are invoked, so no cache line will bounce between rw_strand and dis_strand for every message.
+//ST_ASIO_ACI_SLOTS is the number of the counters (cache lines) per socket, threads more than it will share slots (correctness is not affected).
+#ifdef ST_ASIO_PER_THREAD_ACI
+	#if BOOST_ASIO_VERSION < 101100
+		#error ST_ASIO_PER_THREAD_ACI needs boost 1.66 or higher.
+	#endif
+
+	#ifndef ST_ASIO_ACI_SLOTS
+	#define ST_ASIO_ACI_SLOTS	8
+	#elif ST_ASIO_ACI_SLOTS <= 0
+		#error aci slots must be bigger than zero.
+	#endif
+#endif
+
+//#define ST_ASIO_SINGLE_THREAD_CONTEXT
+//each io_context is run by only one service thread (like the thread-per-core mode, see service_pump::set_thread_per_core), so handlers of
+// one socket are already serialized, then:
+// 1. strands (rw_strand, dis_strand and the strands of dispatch lanes) are just the executors of the io_context (see strand_type),
+//    handlers will not be wrapped by them any more, and dispatch_in_io_strand invokes the handler inline in the service thread.
+// 2. input and output queues are non_lock_queue by default.
+// 3. flags which are only changed in the service thread (sending and reading) are changed without read-modify-write and memory fence.
+// 4. io_contexts are created with concurrency hint 1 by default (see ST_ASIO_CONCURRENCY_HINT).
+//send_msg (series) still can be called in any thread, messages sent from other threads will be posted to the io_context of the socket
+// and be put into the send buffer there (costs one more post and heap allocation per call), they are counted by is_send_buffer_available
+// before they arrived at the send buffer, so the send buffer's limitation still works.
+//please note:
+// 1. service_pump always runs one thread per io_context, the thread_num parameter of start_service and run_service will be ignored.
+// 2. set_dispatch_io_context (so does handler_pool) is not supported, messages are always dispatched in the service thread.
+// 3. pop_first_pending_send_msg, pop_all_pending_send_msg, pop_first_pending_recv_msg and pop_all_pending_recv_msg can only be called
+//    in the service thread, so does changing the packer and unpacker.
+#ifdef ST_ASIO_SINGLE_THREAD_CONTEXT
+	#if BOOST_ASIO_VERSION < 101200
+		#error ST_ASIO_SINGLE_THREAD_CONTEXT needs boost 1.67 or higher (io_context concurrency hints, see ST_ASIO_CONCURRENCY_HINT).
+	#elif defined(ST_ASIO_DECREASE_THREAD_AT_RUNTIME)
+		#error ST_ASIO_SINGLE_THREAD_CONTEXT conflicts with ST_ASIO_DECREASE_THREAD_AT_RUNTIME.
+	#elif defined(ST_ASIO_SHRINK_SEND_BUFFER)
+		#error ST_ASIO_SINGLE_THREAD_CONTEXT conflicts with ST_ASIO_SHRINK_SEND_BUFFER (which touches the send buffer in the calling thread).
+	#endif
+
+	#undef make_strand_handler
+	#define make_strand_handler(S, F) (F)
+
+	#ifndef ST_ASIO_INPUT_QUEUE
+	#define ST_ASIO_INPUT_QUEUE non_lock_queue
+	#endif
+	#ifndef ST_ASIO_OUTPUT_QUEUE
+	#define ST_ASIO_OUTPUT_QUEUE non_lock_queue
+	#endif
+#endif
+
+//the default concurrency hint of io_contexts created by service_pump (boost 1.67 or higher).
+#if BOOST_ASIO_VERSION >= 101200 && !defined(ST_ASIO_CONCURRENCY_HINT)
+	#ifdef ST_ASIO_SINGLE_THREAD_CONTEXT
+	#define ST_ASIO_CONCURRENCY_HINT	1
+	#else
+	#define ST_ASIO_CONCURRENCY_HINT	BOOST_ASIO_CONCURRENCY_HINT_SAFE
+	#endif
+#endif
+
 //full statistic include time consumption, or only numerable informations will be gathered
 //#define ST_ASIO_FULL_STATISTIC
 
+//#define ST_ASIO_TSC_CLOCK
+//x86 and x86_64 only, with macro ST_ASIO_FULL_STATISTIC, use the time stamp counter (rdtsc) instead of system_clock to measure time consumption,
+// it's much cheaper than system_clock::now() (no syscall nor vdso), but the cpu must have invariant tsc (almost all modern cpus have),
+// the tsc will be calibrated against steady_clock when the first service_pump starts (or at the first time it's used if earlier), which
+// blocks for about 20 milliseconds.
+#ifdef ST_ASIO_TSC_CLOCK
+	#ifndef ST_ASIO_FULL_STATISTIC
+		#error macro ST_ASIO_TSC_CLOCK needs macro ST_ASIO_FULL_STATISTIC.
+	#elif !defined(__x86_64__) && !defined(_M_X64) && !defined(__i386__) && !defined(_M_IX86)
+		#error macro ST_ASIO_TSC_CLOCK is only available on x86 and x86_64.
+	#endif
+#endif
+
+//#define ST_ASIO_COARSE_CLOCK	100 //milliseconds
+//if defined, st_asio_wrapper will not call time(NULL) for the timestamps in statistic (last_recv_time, last_send_time, establish_time and
+// break_time, the heartbeat is based on them), but read a cached time which is refreshed every ST_ASIO_COARSE_CLOCK milliseconds by
+// one background ticker (see st_asio_wrapper::coarse_clock), the ticker runs as long as at least one service_pump is running.
+//you must define this macro as a value, not just define it.
+#ifdef ST_ASIO_COARSE_CLOCK
+	#if ST_ASIO_COARSE_CLOCK <= 0 || ST_ASIO_COARSE_CLOCK > 1000
+		#error the resolution of coarse clock must be in the range (0, 1000].
+	#endif
+#endif
+
 //after every msg sent, call st_asio_wrapper::socket::on_msg_send(InMsgType& msg)
 //this macro cannot exists with macro ST_ASIO_WANT_BATCH_MSG_SEND_NOTIFY
 //#define ST_ASIO_WANT_MSG_SEND_NOTIFY
@@ -1242,18 +1449,58 @@
 //close port reuse
 //#define ST_ASIO_NOT_REUSE_ADDRESS
 
+//mpsc_queue (lock-free for producers) is also available for input queue, it's worth trying if many threads send messages to the same socket.
+//lane_queue (multiple lanes with weighted round-robin or strict priority) is also available for input queue, it's worth trying if control messages
+//must not be blocked by bulk messages on the same socket, see lane_queue for more details.
 #ifndef ST_ASIO_INPUT_QUEUE
 #define ST_ASIO_INPUT_QUEUE lock_queue
 #endif
 #ifndef ST_ASIO_INPUT_CONTAINER
 #define ST_ASIO_INPUT_CONTAINER list
 #endif
+//spsc_queue (wait-free for one producer and one consumer) is also available for output queue, and deque is a better container for it,
+//but with spsc_queue, pop_first_pending_recv_msg and pop_all_pending_recv_msg can only be called in on_msg_handle, see spsc_queue for more details.
 #ifndef ST_ASIO_OUTPUT_QUEUE
 #define ST_ASIO_OUTPUT_QUEUE lock_queue
 #endif
 #ifndef ST_ASIO_OUTPUT_CONTAINER
 #define ST_ASIO_OUTPUT_CONTAINER list
 #endif
+
+//pooled_list (nodes are recycled via per-thread free lists) is also available for both input and output container.
+//with pooled_list as both input and output container on both sides, the echo test (echo_server 2, echo_client 2 1 with 16 links and
+// '30000 32 0 0 3') got about 16% more TPS than with list, see demo echo_server and echo_client.
+//how many free nodes (for each node size) a thread can cache for pooled_list, see node_pool for more details.
+#ifndef ST_ASIO_NODE_POOL_CACHE
+#define ST_ASIO_NODE_POOL_CACHE	256
+#elif ST_ASIO_NODE_POOL_CACHE <= 0
+	#error cache size of node pool must be bigger than zero.
+#endif
+
+//make list (which is used by all temporary message containers, like the one passed to on_msg and the ones used by packers and unpackers)
+// recycle nodes via node_pool, just like pooled_list.
+//#define ST_ASIO_POOLED_LIST
+
+//how many bytes of free slabs (see slab_buffer and slicing_unpacker) can be cached by slab_pool, all threads share them.
+#ifndef ST_ASIO_SLAB_CACHE
+#define ST_ASIO_SLAB_CACHE	(1024 * 1024)
+#elif ST_ASIO_SLAB_CACHE < 0
+	#error cache size of slab pool must be bigger than or equal to zero.
+#endif
+
+//how many messages a segment of spsc_queue can hold, each spsc_queue keeps at least one segment and at most one spare segment.
+#ifndef ST_ASIO_SPSC_QUEUE_SEGMENT
+#define ST_ASIO_SPSC_QUEUE_SEGMENT	64
+#elif ST_ASIO_SPSC_QUEUE_SEGMENT <= 0
+	#error segment size of spsc_queue must be bigger than zero.
+#endif
+
+//how many lanes a lane_queue has, lane 0 has the lowest priority and is used by all send_msg series except the *_in_lane ones.
+#ifndef ST_ASIO_SEND_LANE_NUM
+#define ST_ASIO_SEND_LANE_NUM	2
+#elif ST_ASIO_SEND_LANE_NUM <= 0
+	#error lane number of lane_queue must be bigger than zero.
+#endif
 //we also can control the queues (and their containers) via template parameters on class 'client_socket_base'
 //'server_socket_base', 'ssl::client_socket_base' and 'ssl::server_socket_base'.
 //we even can let socket use different queue (and / or different container) for input and output via template parameters.
@@ -1292,25 +1539,55 @@
 //#define ST_ASIO_DECREASE_THREAD_AT_RUNTIME
 //enable decreasing service thread at runtime.
 
+#ifndef ST_ASIO_RECV_LOW_WATERMARK
+#define ST_ASIO_RECV_LOW_WATERMARK	(ST_ASIO_MAX_RECV_BUF / 2) //bytes
+#elif ST_ASIO_RECV_LOW_WATERMARK < 0
+	#error the low watermark of recv buffer must be bigger than or equal to zero.
+#endif
+//msg receiving
+//if receiving buffer is overflow, message receiving will stop, and the dispatcher will resume it right after the buffer dropped to
+// this size (no timers, no polling), keep a gap between it and ST_ASIO_MAX_RECV_BUF to avoid stopping and resuming too frequently.
+//this value can be changed via st_asio_wrapper::socket::recv_low_watermark(size_t) at runtime.
+
 #ifndef ST_ASIO_MSG_RESUMING_INTERVAL
 #define ST_ASIO_MSG_RESUMING_INTERVAL	50 //milliseconds
 #elif ST_ASIO_MSG_RESUMING_INTERVAL < 0
 	#error the interval of msg resuming must be bigger than or equal to zero.
 #endif
-//msg receiving
-//if receiving buffer is overflow, message receiving will stop and resume after the buffer becomes available,
-//this is the interval of receiving buffer checking.
-//this value can be changed via st_asio_wrapper::socket::msg_resuming_interval(size_t) at runtime.
+//deprecated, it does nothing any more, stopped receiving is resumed by the dispatcher, see ST_ASIO_RECV_LOW_WATERMARK.
 
 #ifndef ST_ASIO_MSG_HANDLING_INTERVAL
 #define ST_ASIO_MSG_HANDLING_INTERVAL	50 //milliseconds
-#elif ST_ASIO_MSG_HANDLING_INTERVAL < 0
-	#error the interval of msg handling must be bigger than or equal to zero.
+#elif ST_ASIO_MSG_HANDLING_INTERVAL < -1
+	#error the interval of msg handling must be bigger than or equal to -1.
 #endif
 //msg handling
-//call on_msg_handle, if failed, retry it after ST_ASIO_MSG_HANDLING_INTERVAL milliseconds later.
+//call on_msg_handle, if failed, retry it after ST_ASIO_MSG_HANDLING_INTERVAL milliseconds later (0 means retry immediately), or right after
+// st_asio_wrapper::socket::resume_dispatch() been called, if you always call resume_dispatch() after the failure reason disappeared,
+// set it to -1 (st_asio_wrapper::socket::NO_DISPATCH_TIMER) to disable the timer.
 //this value can be changed via st_asio_wrapper::socket::msg_handling_interval(size_t) at runtime.
 
+//#define ST_ASIO_SEND_WINDOW
+//software cork, when sending messages on an idle socket, hold them in the sending buffer for a while (see ST_ASIO_SEND_WINDOW_INTERVAL and
+// ST_ASIO_SEND_WINDOW_SIZE) rather than sending them immediately, so more messages can be sent in one async_write (less tcp segments and
+// syscalls), at the cost of a bounded latency. call st_asio_wrapper::socket::flush() to send held messages immediately (for latency-critical msgs).
+//the window only takes effect when the socket is idle, messages sent during another sending will be sent just after it as before.
+#ifndef ST_ASIO_SEND_WINDOW_INTERVAL
+#define ST_ASIO_SEND_WINDOW_INTERVAL	0 //milliseconds
+#elif ST_ASIO_SEND_WINDOW_INTERVAL < 0
+	#error the interval of send window must be bigger than or equal to zero.
+#endif
+//how long the messages can be held at most, 0 means until the io_context finished its current round (sub-millisecond latency).
+//this value can be changed via st_asio_wrapper::socket::send_window_interval(unsigned) at runtime.
+
+#ifndef ST_ASIO_SEND_WINDOW_SIZE
+#define ST_ASIO_SEND_WINDOW_SIZE	(16 * 1024) //bytes
+#elif ST_ASIO_SEND_WINDOW_SIZE < 0
+	#error the size of send window must be bigger than or equal to zero.
+#endif
+//if the sending buffer holds this many bytes, stop holding and send them immediately, 0 means no limitation.
+//this value can be changed via st_asio_wrapper::socket::send_window_size(size_t) at runtime.
+
 //#define ST_ASIO_EXPOSE_SEND_INTERFACE
 //for some reason (I still not met yet), the message sending has stopped but some messages left behind in the sending buffer, they won't be
 // sent until new messages come in, define this macro to expose send_msg() interface, then you can call it manually to fix this situation.
@@ -43,6 +43,23 @@ private:
 	boost::mutex mutex; //boost::mutex is more efficient than boost::shared_mutex
 };
 
+//the size (in bytes) of a queue, it's only changed by one thread at a time (with the queue locked, or in the only thread which uses a
+// non_lock_queue), but can be read in any threads without locking (like is_send_buffer_available), so relaxed loads and stores (no
+// read-modify-write) are enough, they are as cheap as accessing a plain size_t on most platforms.
+class queue_size
+{
+public:
+	queue_size(size_t size_ = 0) : size(size_) {}
+
+	operator size_t() const {return size.load(boost::memory_order_relaxed);}
+	queue_size& operator=(size_t size_) {size.store(size_, boost::memory_order_relaxed); return *this;}
+	queue_size& operator+=(size_t size_) {return *this = *this + size_;}
+	queue_size& operator-=(size_t size_) {return *this = *this - size_;}
+
+private:
+	atomic_size_t size;
+};
+
 //Container must at least has the following functions (like boost::container::list):
 // Container() constructor
 // empty
@@ -253,7 +270,7 @@ protected:
 	}
 
 private:
-	size_t total_size;
+	queue_size total_size;
 };
 
 //st_asio_wrapper requires that queue must take one and only one template argument
@@ -270,6 +287,887 @@ public:
 	lock_queue(size_t capacity) : queue<Container, lockable>(capacity) {}
 };
 
+//multi-lane queue, designed for input queue (ST_ASIO_INPUT_QUEUE), it has ST_ASIO_SEND_LANE_NUM lanes which share one size_in_byte,
+// so all lanes share one send buffer budget (send_buf_size()).
+//enqueue and move_items_in put messages into lane 0 (so all send_msg series use lane 0), enqueue_front and move_items_in_front put
+// messages at the front of the highest lane (so 'prior' still means the most urgent), enqueue_in_lane puts messages into the specified lane,
+// see socket::direct_send_msg_in_lane and tcp::socket_base::send_msg_in_lane.
+//messages are taken out (try_dequeue and move_items_out) lane by lane, either with weighted round-robin (based on message number,
+// see lane_weight) or strict priority (the higher lane the higher priority, see strict_priority), and the round-robin state is kept
+// across calls, so a burst of bulk messages in one lane cannot hold up other lanes for more than one sending batch.
+//please note that shrink_send_buffer also discards messages in this order.
+template<typename Container> class lane_queue : public lockable
+{
+public:
+	typedef typename Container::value_type value_type;
+	typedef typename Container::size_type size_type;
+	typedef typename Container::reference reference;
+	typedef typename Container::const_reference const_reference;
+
+	lane_queue() : total_size(0), strict(false), cur_lane(0), credit(1) {for (size_t i = 0; i < ST_ASIO_SEND_LANE_NUM; ++i) weights[i] = 1;}
+
+	size_t size() const {size_t num = 0; for (size_t i = 0; i < ST_ASIO_SEND_LANE_NUM; ++i) num += lanes[i].size(); return num;}
+	bool empty() const {for (size_t i = 0; i < ST_ASIO_SEND_LANE_NUM; ++i) if (!lanes[i].empty()) return false; return true;}
+
+	//thread safe
+	//weight is how many messages can be taken out from a lane in each round (of round-robin), it must be bigger than zero.
+	//invalid lanes (see check_lane) will be ignored, and their weights are zero.
+	void lane_weight(size_t lane, unsigned weight) {assert(weight > 0); if (check_lane(lane)) {lockable::lock_guard lock(*this); weights[lane] = weight > 0 ? weight : 1;}}
+	unsigned lane_weight(size_t lane) const {return check_lane(lane) ? weights[lane] : 0;}
+	void strict_priority(bool strict_) {lockable::lock_guard lock(*this); strict = strict_;}
+	bool strict_priority() const {return strict;}
+
+	//a lane must be less than ST_ASIO_SEND_LANE_NUM, invalid lanes are rejected rather than being mapped to other lanes,
+	// because that would send messages with unexpected priorities.
+	static bool check_lane(size_t lane)
+	{
+		if (lane < ST_ASIO_SEND_LANE_NUM)
+			return true;
+
+		unified_out::error_out("invalid lane " ST_ASIO_SF ", there are only %d lanes.", lane, ST_ASIO_SEND_LANE_NUM);
+		return false;
+	}
+
+	bool is_thread_safe() const {return true;}
+	size_t size_in_byte() const {return total_size;}
+	bool is_empty() {lockable::lock_guard lock(*this); return empty();}
+	void clear() {lockable::lock_guard lock(*this); for (size_t i = 0; i < ST_ASIO_SEND_LANE_NUM; ++i) lanes[i].clear(); total_size = 0;}
+	void swap(Container& can) {lockable::lock_guard lock(*this); swap_(can);}
+
+	template<typename T> bool enqueue(const T& item) {lockable::lock_guard lock(*this); return enqueue_(item);}
+	template<typename T> bool enqueue(T& item) {lockable::lock_guard lock(*this); return enqueue_(item);}
+	template<typename T> bool enqueue_in_lane(size_t lane, const T& item, bool prior = false) {lockable::lock_guard lock(*this); return enqueue_in_lane_(lane, item, prior);}
+	template<typename T> bool enqueue_in_lane(size_t lane, T& item, bool prior = false) {lockable::lock_guard lock(*this); return enqueue_in_lane_(lane, item, prior);}
+	void move_items_in(Container& src, size_t size_in_byte = 0) {lockable::lock_guard lock(*this); move_items_in_(src, size_in_byte);}
+	template<typename T> bool enqueue_front(const T& item) {lockable::lock_guard lock(*this); return enqueue_front_(item);}
+	template<typename T> bool enqueue_front(T& item) {lockable::lock_guard lock(*this); return enqueue_front_(item);}
+	void move_items_in_front(Container& src, size_t size_in_byte = 0) {lockable::lock_guard lock(*this); move_items_in_front_(src, size_in_byte);}
+	bool try_dequeue(reference item) {lockable::lock_guard lock(*this); return try_dequeue_(item);}
+	void move_items_out(Container& dest, size_t max_item_num = -1) {lockable::lock_guard lock(*this); move_items_out_(dest, max_item_num);}
+	void move_items_out(size_t max_size_in_byte, Container& dest) {lockable::lock_guard lock(*this); move_items_out_(max_size_in_byte, dest);}
+	template<typename _Predicate> void do_something_to_all(const _Predicate& __pred) {lockable::lock_guard lock(*this); do_something_to_all_(__pred);}
+	template<typename _Predicate> void do_something_to_one(const _Predicate& __pred) {lockable::lock_guard lock(*this); do_something_to_one_(__pred);}
+	//thread safe
+
+	//not thread safe
+	template<typename T> bool enqueue_(const T& item) {return enqueue_in_lane_(0, item);}
+	template<typename T> bool enqueue_(T& item) {return enqueue_in_lane_(0, item);} //after this, item will becomes empty, please note.
+
+	//return false if lane is invalid (see check_lane), the item will not be touched.
+	template<typename T> bool enqueue_in_lane_(size_t lane, const T& item, bool prior = false)
+	{
+		if (!check_lane(lane))
+			return false;
+
+		size_t size = item.size();
+		BOOST_AUTO(&q, lanes[lane]);
+		if (!(prior ? q.enqueue_front_(item) : q.enqueue_(item)))
+			return false;
+
+		total_size += size;
+		return true;
+	}
+
+	template<typename T> bool enqueue_in_lane_(size_t lane, T& item, bool prior = false) //after this, item will becomes empty, please note.
+	{
+		if (!check_lane(lane))
+			return false;
+
+		size_t size = item.size();
+		BOOST_AUTO(&q, lanes[lane]);
+		if (!(prior ? q.enqueue_front_(item) : q.enqueue_(item)))
+			return false;
+
+		total_size += size;
+		return true;
+	}
+
+	void move_items_in_(Container& src, size_t size_in_byte = 0)
+	{
+		if (0 == size_in_byte)
+			size_in_byte = st_asio_wrapper::get_size_in_byte(src);
+
+		lanes[0].move_items_in_(src, size_in_byte);
+		total_size += size_in_byte;
+	}
+
+	template<typename T> bool enqueue_front_(const T& item) {return enqueue_in_lane_(ST_ASIO_SEND_LANE_NUM - 1, item, true);}
+	template<typename T> bool enqueue_front_(T& item) {return enqueue_in_lane_(ST_ASIO_SEND_LANE_NUM - 1, item, true);} //after this, item will becomes empty, please note.
+
+	void move_items_in_front_(Container& src, size_t size_in_byte = 0)
+	{
+		if (0 == size_in_byte)
+			size_in_byte = st_asio_wrapper::get_size_in_byte(src);
+
+		lanes[ST_ASIO_SEND_LANE_NUM - 1].move_items_in_front_(src, size_in_byte);
+		total_size += size_in_byte;
+	}
+
+	void swap_(Container& can)
+	{
+		Container temp_can;
+		for (size_t i = ST_ASIO_SEND_LANE_NUM; i > 0; --i)
+			lanes[i - 1].move_items_out_(temp_can);
+
+		lanes[0].swap(can);
+		can.swap(temp_can);
+		total_size = lanes[0].size_in_byte();
+	}
+
+	bool try_dequeue_(reference item)
+	{
+		size_t lane = next_lane();
+		if (ST_ASIO_SEND_LANE_NUM == lane)
+			return false;
+
+		lanes[lane].try_dequeue_(item);
+		total_size -= item.size();
+		return true;
+	}
+
+	void move_items_out_(Container& dest, size_t max_item_num = -1)
+	{
+		for (size_t lane; max_item_num > 0 && ST_ASIO_SEND_LANE_NUM != (lane = next_lane()); --max_item_num)
+		{
+			lanes[lane].move_items_out_(dest, 1);
+			total_size -= dest.back().size();
+		}
+	}
+
+	void move_items_out_(size_t max_size_in_byte, Container& dest)
+	{
+		size_t size = 0;
+		for (size_t lane; size < max_size_in_byte && ST_ASIO_SEND_LANE_NUM != (lane = next_lane());)
+		{
+			lanes[lane].move_items_out_(dest, 1);
+			size += dest.back().size();
+		}
+		total_size -= size;
+	}
+
+	template<typename _Predicate>
+	void do_something_to_all_(const _Predicate& __pred) {for (size_t i = ST_ASIO_SEND_LANE_NUM; i > 0; --i) lanes[i - 1].do_something_to_all_(__pred);}
+
+	template<typename _Predicate>
+	void do_something_to_one_(const _Predicate& __pred)
+	{
+		bool found = false;
+		for (size_t i = ST_ASIO_SEND_LANE_NUM; !found && i > 0; --i)
+			lanes[i - 1].do_something_to_one_(found_recorder<_Predicate>(__pred, found));
+	}
+	//not thread safe
+
+private:
+	template<typename _Predicate> struct found_recorder
+	{
+		found_recorder(const _Predicate& __pred, bool& found_) : pred(__pred), found(found_) {}
+		template<typename T> bool operator()(T& item) const {return found = pred(item);}
+
+		const _Predicate& pred;
+		bool& found;
+	};
+
+
+	//return ST_ASIO_SEND_LANE_NUM if all lanes are empty
+	size_t next_lane()
+	{
+		if (strict)
+		{
+			for (size_t i = ST_ASIO_SEND_LANE_NUM; i > 0; --i)
+				if (!lanes[i - 1].empty())
+					return i - 1;
+		}
+		else
+			for (size_t i = 0; i <= ST_ASIO_SEND_LANE_NUM; ++i) //at most one round
+			{
+				if (credit > 0 && !lanes[cur_lane].empty())
+				{
+					--credit;
+					return cur_lane;
+				}
+
+				cur_lane = (cur_lane + 1) % ST_ASIO_SEND_LANE_NUM;
+				credit = weights[cur_lane];
+			}
+
+		return ST_ASIO_SEND_LANE_NUM;
+	}
+
+private:
+	non_lock_queue<Container> lanes[ST_ASIO_SEND_LANE_NUM];
+	queue_size total_size;
+
+	unsigned weights[ST_ASIO_SEND_LANE_NUM];
+	bool strict;
+	size_t cur_lane;
+	unsigned credit;
+};
+
+#if BOOST_VERSION >= 105300
+//lock-free multi-producer / single-consumer queue, designed for input queue (ST_ASIO_INPUT_QUEUE), because many threads send messages
+// to the same socket while only the sending procedure (in rw_strand) takes them out.
+//producers (enqueue and move_items_in) never lock, each of them pushes its messages (wrapped by a node) into a lock-free stack with a CAS,
+// nodes are recycled by node_pool, so the only allocation per message is the one made by Container (none with pooled_list).
+//all other functions are consumer functions, they grab the whole stack with one atomic exchange, reverse it and splice messages into
+// a private container, which is guarded by a mutex that only consumers (the sending procedure, and user's pop_first_pending_send_msg,
+// pop_all_pending_send_msg, shrink_send_buffer etc.) will contend for, please note that enqueue_front and move_items_in_front are consumer functions too.
+//this queue exposes lock() and unlock() (which only lock out other consumers), so shrink_send_buffer still works.
+template<typename Container> class mpsc_queue : public lockable
+{
+public:
+	typedef typename Container::value_type value_type;
+	typedef typename Container::size_type size_type;
+	typedef typename Container::reference reference;
+	typedef typename Container::const_reference const_reference;
+
+	mpsc_queue() : pending(NULL), total_num(0), total_size(0) {}
+	~mpsc_queue() {clear_pending();}
+
+	//not accurate if producers are enqueuing messages concurrently, st_asio_wrapper will not use these two functions.
+	size_t size() const {boost::int_fast64_t num = total_num.load(boost::memory_order_relaxed); return num > 0 ? (size_t) num : 0;}
+	bool empty() const {return is_empty();}
+
+	//thread safe
+	bool is_thread_safe() const {return true;}
+	//a consumer may take messages out before the producer accumulated them, so the sum can be negative for a very short time.
+	size_t size_in_byte() const {boost::int_fast64_t size = total_size.load(boost::memory_order_relaxed); return size > 0 ? (size_t) size : 0;}
+	//producers accumulate total_num after messages been pushed, consumers decrease it after messages been taken out,
+	//so once enqueue returned, is_empty in any other thread will see the new messages until they've been taken out.
+	//the full fence is necessary, because socket calls is_empty right after clearing the sending flag (a store), while producers check
+	// the sending flag right after enqueuing messages, without the fence, both sides may see stale values and no one will send the messages.
+	bool is_empty() const {boost::atomic_thread_fence(boost::memory_order_seq_cst); return total_num.load(boost::memory_order_relaxed) <= 0;}
+	void clear() {lockable::lock_guard lock(*this); clear_();}
+	void swap(Container& can_) {lockable::lock_guard lock(*this); swap_(can_);}
+
+	template<typename T> bool enqueue(const T& item) {return enqueue_(item);}
+	template<typename T> bool enqueue(T& item) {return enqueue_(item);}
+	bool move_items_in(Container& src, size_t size_in_byte = 0) {return move_items_in_(src, size_in_byte);}
+	template<typename T> bool enqueue_front(const T& item) {lockable::lock_guard lock(*this); return enqueue_front_(item);}
+	template<typename T> bool enqueue_front(T& item) {lockable::lock_guard lock(*this); return enqueue_front_(item);}
+	void move_items_in_front(Container& src, size_t size_in_byte = 0) {lockable::lock_guard lock(*this); move_items_in_front_(src, size_in_byte);}
+	bool try_dequeue(reference item) {lockable::lock_guard lock(*this); return try_dequeue_(item);}
+	void move_items_out(Container& dest, size_t max_item_num = -1) {lockable::lock_guard lock(*this); move_items_out_(dest, max_item_num);}
+	void move_items_out(size_t max_size_in_byte, Container& dest) {lockable::lock_guard lock(*this); move_items_out_(max_size_in_byte, dest);}
+	template<typename _Predicate> void do_something_to_all(const _Predicate& __pred) {lockable::lock_guard lock(*this); do_something_to_all_(__pred);}
+	template<typename _Predicate> void do_something_to_one(const _Predicate& __pred) {lockable::lock_guard lock(*this); do_something_to_one_(__pred);}
+	//thread safe
+
+	//producer functions, they're always thread safe
+	template<typename T> bool enqueue_(const T& item)
+	{
+		node* n = NULL;
+		try
+		{
+			n = create_node();
+			n->can.emplace_back(item);
+		}
+		catch (const std::exception& e)
+		{
+			destroy_node(n);
+			unified_out::error_out("cannot hold more objects (%s)", e.what());
+			return false;
+		}
+
+		push(n, 1, item.size());
+		return true;
+	}
+
+	template<typename T> bool enqueue_(T& item) //after this, item will becomes empty, please note.
+	{
+		node* n = NULL;
+		try
+		{
+			n = create_node();
+			n->can.emplace_back().swap(item); //with c++0x, this can be emplace_back(item)
+		}
+		catch (const std::exception& e)
+		{
+			destroy_node(n);
+			unified_out::error_out("cannot hold more objects (%s)", e.what());
+			return false;
+		}
+
+		push(n, 1, n->can.back().size());
+		return true;
+	}
+
+	//if failed (out of memory), src will be untouched.
+	bool move_items_in_(Container& src, size_t size_in_byte = 0)
+	{
+		size_t num = 0, size = 0;
+		statistic_(src, num, size);
+		if (0 == num)
+			return true;
+		assert(0 == size_in_byte || size == size_in_byte);
+
+		node* n = NULL;
+		try
+		{
+			n = create_node();
+		}
+		catch (const std::exception& e)
+		{
+			unified_out::error_out("cannot hold more objects (%s)", e.what());
+			return false;
+		}
+
+		n->can.splice(n->can.end(), src);
+		push(n, num, size);
+		return true;
+	}
+	//producer functions
+
+	//consumer functions, not thread safe (call lock() and unlock() by yourself)
+	void clear_()
+	{
+		collect();
+
+		size_t num = 0, size = 0;
+		statistic_(can, num, size);
+		can.clear();
+		decrease(num, size);
+	}
+
+	void swap_(Container& can_)
+	{
+		collect();
+
+		size_t num = 0, size = 0, num_ = 0, size_ = 0;
+		statistic_(can, num, size);
+		statistic_(can_, num_, size_);
+		can.swap(can_);
+		increase(num_, size_);
+		decrease(num, size);
+	}
+
+	template<typename T> bool enqueue_front_(const T& item)
+	{
+		collect();
+		try
+		{
+			can.emplace_front(item);
+		}
+		catch (const std::exception& e)
+		{
+			unified_out::error_out("cannot hold more objects (%s)", e.what());
+			return false;
+		}
+
+		increase(1, item.size());
+		return true;
+	}
+
+	template<typename T> bool enqueue_front_(T& item) //after this, item will becomes empty, please note.
+	{
+		collect();
+		try
+		{
+			size_t size = item.size();
+			can.emplace_front().swap(item); //with c++0x, this can be emplace_front(item)
+			increase(1, size);
+		}
+		catch (const std::exception& e)
+		{
+			unified_out::error_out("cannot hold more objects (%s)", e.what());
+			return false;
+		}
+
+		return true;
+	}
+
+	void move_items_in_front_(Container& src, size_t size_in_byte = 0)
+	{
+		size_t num = 0, size = 0;
+		statistic_(src, num, size);
+		assert(0 == size_in_byte || size == size_in_byte);
+
+		collect();
+		can.splice(can.begin(), src);
+		increase(num, size);
+	}
+
+	bool try_dequeue_(reference item)
+	{
+		collect();
+		if (can.empty())
+			return false;
+
+		item.swap(can.front());
+		can.pop_front();
+		decrease(1, item.size());
+		return true;
+	}
+
+	void move_items_out_(Container& dest, size_t max_item_num = -1)
+	{
+		collect();
+
+		size_t size = 0, index = 0;
+		BOOST_AUTO(end_iter, can.begin());
+		for (; end_iter != can.end() && index < max_item_num; ++end_iter, ++index)
+			size += end_iter->size();
+
+		move_items_out(dest, end_iter, index, size);
+	}
+
+	void move_items_out_(size_t max_size_in_byte, Container& dest)
+	{
+		collect();
+
+		size_t size = 0, index = 0;
+		BOOST_AUTO(end_iter, can.begin());
+		while (end_iter != can.end())
+		{
+			++index;
+			size += end_iter++->size();
+			if (size >= max_size_in_byte)
+				break;
+		}
+
+		move_items_out(dest, end_iter, index, size);
+	}
+
+	template<typename _Predicate>
+	void do_something_to_all_(const _Predicate& __pred) {collect(); for (BOOST_AUTO(iter, can.begin()); iter != can.end(); ++iter) __pred(*iter);}
+
+	template<typename _Predicate>
+	void do_something_to_one_(const _Predicate& __pred) {collect(); for (BOOST_AUTO(iter, can.begin()); iter != can.end(); ++iter) if (__pred(*iter)) break;}
+	//consumer functions
+
+private:
+	struct node
+	{
+		node* next;
+		Container can;
+
+		node() : next(NULL) {}
+	};
+
+	static node* create_node() {void* p = node_pool<sizeof(node)>::allocate(); return new (p) node();} //node's constructor never throws
+	static void destroy_node(node* n) {if (NULL != n) {n->~node(); node_pool<sizeof(node)>::deallocate(n);}}
+
+	static void statistic_(const Container& can_, size_t& num, size_t& size)
+		{for (BOOST_AUTO(iter, can_.begin()); iter != can_.end(); ++iter, ++num) size += iter->size();}
+
+	void increase(size_t num, size_t size) {total_size += (boost::int_fast64_t) size; total_num += (boost::int_fast64_t) num;}
+	void decrease(size_t num, size_t size) {total_num -= (boost::int_fast64_t) num; total_size -= (boost::int_fast64_t) size;}
+
+	void push(node* n, size_t num, size_t size)
+	{
+		//don't use n->next as the expected value, CAS may write it back even on success, at that time, n is already visible to the consumer
+		node* head = pending.load(boost::memory_order_relaxed);
+		do n->next = head; while (!pending.compare_exchange_weak(head, n, boost::memory_order_release, boost::memory_order_relaxed));
+		increase(num, size); //after n been pushed, see is_empty for more details
+	}
+
+	//take all pending nodes and splice their messages (in the order of enqueuing) into the private container
+	void collect()
+	{
+		node* head = pending.exchange(NULL, boost::memory_order_acquire);
+		if (NULL == head)
+			return;
+
+		node* reversed = NULL;
+		while (NULL != head)
+		{
+			node* next = head->next;
+			head->next = reversed;
+			reversed = head;
+			head = next;
+		}
+
+		while (NULL != reversed)
+		{
+			node* next = reversed->next;
+			can.splice(can.end(), reversed->can);
+			destroy_node(reversed);
+			reversed = next;
+		}
+	}
+
+	void clear_pending()
+	{
+		node* head = pending.exchange(NULL, boost::memory_order_acquire);
+		while (NULL != head)
+		{
+			node* next = head->next;
+			destroy_node(head);
+			head = next;
+		}
+	}
+
+	void move_items_out(Container& dest, typename Container::const_iterator end_iter, size_t num, size_t size)
+	{
+		if (end_iter == can.end())
+			dest.splice(dest.end(), can);
+		else
+			dest.splice(dest.end(), can, can.begin(), end_iter);
+
+		decrease(num, size);
+	}
+
+private:
+	boost::atomic<node*> pending;
+	boost::atomic<boost::int_fast64_t> total_num, total_size;
+	Container can; //only accessed by consumers
+};
+
+//wait-free single-producer / single-consumer queue, designed for output queue (ST_ASIO_OUTPUT_QUEUE), because only the receiving procedure
+// (in rw_strand) puts messages into it while only the dispatching procedure (in dis_strand) takes them out.
+//messages are stored in fixed-size segments (ST_ASIO_SPSC_QUEUE_SEGMENT items per segment) which are used as a ring, the producer only
+// allocates a new segment if the consumer has not returned the spare one, so no memory allocation in the steady state.
+//segments are chained rather than the queue been strictly bounded, because the receiving procedure cannot fail to put messages in,
+// the receive buffer is still bounded by recv_buf_size() via byte accounting (size_in_byte), just like other queues.
+//producer functions: enqueue and move_items_in, all other functions are consumer functions, so pop_first_pending_recv_msg and
+// pop_all_pending_recv_msg can only be called in on_msg_handle (or after the socket stopped) with this queue, please note.
+//Container only needs Container(size_t), empty, clear, swap, size, emplace_back, emplace_front, front, pop_front, begin and end,
+// so deque (which allocates memory by blocks) is a good choice.
+template<typename Container> class spsc_queue : public dummy_lockable
+{
+public:
+	typedef typename Container::value_type value_type;
+	typedef typename Container::size_type size_type;
+	typedef typename Container::reference reference;
+	typedef typename Container::const_reference const_reference;
+
+	spsc_queue() : spare(NULL), produced(0), consumed(0), front_num(0), total_size(0)
+		{head_seg = tail_seg = new segment(); head_index = tail_index = 0;}
+	~spsc_queue()
+	{
+		while (NULL != head_seg)
+		{
+			segment* next = head_seg->next;
+			delete head_seg;
+			head_seg = next;
+		}
+		delete spare.exchange(NULL, boost::memory_order_acquire);
+	}
+
+	size_t size() const {return front_num.load(boost::memory_order_relaxed) + produced.load(boost::memory_order_relaxed) - consumed.load(boost::memory_order_relaxed);}
+	bool empty() const {return is_empty();}
+
+	//thread safe (for one producer and one consumer)
+	bool is_thread_safe() const {return true;}
+	size_t size_in_byte() const {return total_size.load(boost::memory_order_relaxed);}
+	//the full fence plays the same role as in mpsc_queue::is_empty
+	bool is_empty() const
+	{
+		boost::atomic_thread_fence(boost::memory_order_seq_cst);
+		return 0 == front_num.load(boost::memory_order_relaxed) && consumed.load(boost::memory_order_relaxed) == produced.load(boost::memory_order_acquire);
+	}
+	void clear() {clear_();}
+	void swap(Container& can) {swap_(can);}
+
+	template<typename T> bool enqueue(const T& item) {return enqueue_(item);}
+	template<typename T> bool enqueue(T& item) {return enqueue_(item);}
+	void move_items_in(Container& src, size_t size_in_byte = 0) {move_items_in_(src, size_in_byte);}
+	template<typename T> bool enqueue_front(const T& item) {return enqueue_front_(item);}
+	template<typename T> bool enqueue_front(T& item) {return enqueue_front_(item);}
+	void move_items_in_front(Container& src, size_t size_in_byte = 0) {move_items_in_front_(src, size_in_byte);}
+	bool try_dequeue(reference item) {return try_dequeue_(item);}
+	void move_items_out(Container& dest, size_t max_item_num = -1) {move_items_out_(dest, max_item_num);}
+	void move_items_out(size_t max_size_in_byte, Container& dest) {move_items_out_(max_size_in_byte, dest);}
+	template<typename _Predicate> void do_something_to_all(const _Predicate& __pred) {do_something_to_all_(__pred);}
+	template<typename _Predicate> void do_something_to_one(const _Predicate& __pred) {do_something_to_one_(__pred);}
+	//thread safe (for one producer and one consumer)
+
+	//producer functions
+	template<typename T> bool enqueue_(const T& item)
+	{
+		try
+		{
+			value_type temp(item);
+			next_slot().swap(temp); //next_slot has no side effects if it throws
+			total_size.fetch_add(item.size(), boost::memory_order_relaxed);
+		}
+		catch (const std::exception& e)
+		{
+			unified_out::error_out("cannot hold more objects (%s)", e.what());
+			return false;
+		}
+
+		produced.store(produced.load(boost::memory_order_relaxed) + 1, boost::memory_order_release);
+		return true;
+	}
+
+	template<typename T> bool enqueue_(T& item) //after this, item will becomes empty, please note.
+	{
+		try
+		{
+			size_t size = item.size();
+			next_slot().swap(item);
+			total_size.fetch_add(size, boost::memory_order_relaxed);
+		}
+		catch (const std::exception& e)
+		{
+			unified_out::error_out("cannot hold more objects (%s)", e.what());
+			return false;
+		}
+
+		produced.store(produced.load(boost::memory_order_relaxed) + 1, boost::memory_order_release);
+		return true;
+	}
+
+	void move_items_in_(Container& src, size_t size_in_byte = 0) //after this, src will becomes empty, please note.
+	{
+		size_t num = 0, size = 0;
+		try
+		{
+			for (BOOST_AUTO(iter, src.begin()); iter != src.end(); ++iter, ++num)
+			{
+				value_type& slot = next_slot(); //next_slot has no side effects if it throws
+				size += iter->size();
+				slot.swap(*iter);
+			}
+			assert(0 == size_in_byte || size == size_in_byte);
+		}
+		catch (const std::exception& e)
+		{
+			unified_out::error_out("cannot hold more objects (%s)", e.what());
+		}
+		src.clear();
+
+		total_size.fetch_add(size, boost::memory_order_relaxed);
+		produced.store(produced.load(boost::memory_order_relaxed) + num, boost::memory_order_release); //publish all items at once
+	}
+	//producer functions
+
+	//consumer functions
+	void clear_()
+	{
+		size_t size = st_asio_wrapper::get_size_in_byte(front_can);
+		front_can.clear();
+		front_num.store(0, boost::memory_order_relaxed);
+
+		for (size_t num = available(); num > 0; --num)
+		{
+			value_type& slot = first_slot();
+			size += slot.size();
+			slot.clear();
+			pop_slot();
+		}
+		total_size.fetch_sub(size, boost::memory_order_relaxed);
+	}
+
+	void swap_(Container& can)
+	{
+		size_t size_in_byte = st_asio_wrapper::get_size_in_byte(can), num = can.size();
+
+		Container temp_can;
+		move_items_out_(temp_can);
+		front_can.swap(can);
+		can.swap(temp_can);
+
+		total_size.fetch_add(size_in_byte, boost::memory_order_relaxed);
+		front_num.store(num, boost::memory_order_release);
+	}
+
+	template<typename T> bool enqueue_front_(const T& item)
+	{
+		try
+		{
+			front_can.emplace_front(item);
+		}
+		catch (const std::exception& e)
+		{
+			unified_out::error_out("cannot hold more objects (%s)", e.what());
+			return false;
+		}
+
+		total_size.fetch_add(item.size(), boost::memory_order_relaxed);
+		front_num.fetch_add(1, boost::memory_order_release);
+		return true;
+	}
+
+	template<typename T> bool enqueue_front_(T& item) //after this, item will becomes empty, please note.
+	{
+		try
+		{
+			size_t size = item.size();
+			front_can.emplace_front().swap(item); //with c++0x, this can be emplace_front(item)
+			total_size.fetch_add(size, boost::memory_order_relaxed);
+		}
+		catch (const std::exception& e)
+		{
+			unified_out::error_out("cannot hold more objects (%s)", e.what());
+			return false;
+		}
+
+		front_num.fetch_add(1, boost::memory_order_release);
+		return true;
+	}
+
+	void move_items_in_front_(Container& src, size_t size_in_byte = 0) //after this, src will becomes empty, please note.
+	{
+		if (0 == size_in_byte)
+			size_in_byte = st_asio_wrapper::get_size_in_byte(src);
+		else
+			assert(st_asio_wrapper::get_size_in_byte(src) == size_in_byte);
+
+		size_t num = src.size();
+		for (BOOST_AUTO(iter, front_can.begin()); iter != front_can.end(); ++iter)
+			src.emplace_back().swap(*iter);
+		front_can.swap(src);
+		src.clear();
+
+		total_size.fetch_add(size_in_byte, boost::memory_order_relaxed);
+		front_num.fetch_add(num, boost::memory_order_release);
+	}
+
+	bool try_dequeue_(reference item)
+	{
+		if (!front_can.empty())
+		{
+			item.swap(front_can.front());
+			front_can.pop_front();
+			front_num.fetch_sub(1, boost::memory_order_relaxed);
+		}
+		else if (available() > 0)
+		{
+			item.swap(first_slot());
+			first_slot().clear();
+			pop_slot();
+		}
+		else
+			return false;
+
+		total_size.fetch_sub(item.size(), boost::memory_order_relaxed);
+		return true;
+	}
+
+	void move_items_out_(Container& dest, size_t max_item_num = -1)
+	{
+		size_t size = 0;
+		for (; max_item_num > 0 && !front_can.empty(); --max_item_num)
+		{
+			size += front_can.front().size();
+			dest.emplace_back().swap(front_can.front());
+			front_can.pop_front();
+			front_num.fetch_sub(1, boost::memory_order_relaxed);
+		}
+
+		for (size_t num = std::min(max_item_num, available()); num > 0; --num)
+		{
+			size += first_slot().size();
+			dest.emplace_back().swap(first_slot());
+			pop_slot();
+		}
+		total_size.fetch_sub(size, boost::memory_order_relaxed);
+	}
+
+	void move_items_out_(size_t max_size_in_byte, Container& dest)
+	{
+		size_t size = 0;
+		while (size < max_size_in_byte && !front_can.empty())
+		{
+			size += front_can.front().size();
+			dest.emplace_back().swap(front_can.front());
+			front_can.pop_front();
+			front_num.fetch_sub(1, boost::memory_order_relaxed);
+		}
+
+		for (size_t num = available(); size < max_size_in_byte && num > 0; --num)
+		{
+			size += first_slot().size();
+			dest.emplace_back().swap(first_slot());
+			pop_slot();
+		}
+		total_size.fetch_sub(size, boost::memory_order_relaxed);
+	}
+
+	template<typename _Predicate> void do_something_to_all_(const _Predicate& __pred)
+	{
+		for (BOOST_AUTO(iter, front_can.begin()); iter != front_can.end(); ++iter)
+			__pred(*iter);
+
+		segment* seg = head_seg;
+		for (size_t num = available(), index = head_index; num > 0; --num, ++index)
+		{
+			if (ST_ASIO_SPSC_QUEUE_SEGMENT == index)
+			{
+				seg = seg->next;
+				index = 0;
+			}
+			__pred(seg->slots[index]);
+		}
+	}
+
+	template<typename _Predicate> void do_something_to_one_(const _Predicate& __pred)
+	{
+		for (BOOST_AUTO(iter, front_can.begin()); iter != front_can.end(); ++iter)
+			if (__pred(*iter))
+				return;
+
+		segment* seg = head_seg;
+		for (size_t num = available(), index = head_index; num > 0; --num, ++index)
+		{
+			if (ST_ASIO_SPSC_QUEUE_SEGMENT == index)
+			{
+				seg = seg->next;
+				index = 0;
+			}
+			if (__pred(seg->slots[index]))
+				break;
+		}
+	}
+	//consumer functions
+
+private:
+	struct segment
+	{
+		segment* next; //written by the producer before publishing items in the next segment, so no atomic needed
+		value_type slots[ST_ASIO_SPSC_QUEUE_SEGMENT];
+
+		segment() : next(NULL) {}
+	};
+
+	//producer only
+	value_type& next_slot()
+	{
+		if (ST_ASIO_SPSC_QUEUE_SEGMENT == tail_index)
+		{
+			segment* seg = spare.exchange(NULL, boost::memory_order_acquire);
+			if (NULL == seg)
+				seg = new segment();
+
+			tail_seg->next = seg;
+			tail_seg = seg;
+			tail_index = 0;
+		}
+
+		return tail_seg->slots[tail_index++];
+	}
+
+	//consumer only
+	size_t available() const {return produced.load(boost::memory_order_acquire) - consumed.load(boost::memory_order_relaxed);}
+	value_type& first_slot()
+	{
+		if (ST_ASIO_SPSC_QUEUE_SEGMENT == head_index) //the producer must have linked the next segment since there're available items
+		{
+			segment* seg = head_seg;
+			head_seg = head_seg->next;
+			head_index = 0;
+
+			seg->next = NULL;
+			delete spare.exchange(seg, boost::memory_order_release); //give it back to the producer
+		}
+
+		return head_seg->slots[head_index];
+	}
+	void pop_slot() {++head_index; consumed.store(consumed.load(boost::memory_order_relaxed) + 1, boost::memory_order_release);}
+
+private:
+	segment* head_seg; //consumer only
+	size_t head_index; //consumer only
+	segment* tail_seg; //producer only
+	size_t tail_index; //producer only
+	boost::atomic<segment*> spare;
+
+	atomic_size_t produced, consumed, front_num, total_size;
+	Container front_can; //items put in by consumer functions (enqueue_front, move_items_in_front and swap), only accessed by the consumer
+};
+#endif
+
 } //namespace
 
 #endif /* ST_ASIO_CONTAINER_H_ */
@@ -19,9 +19,107 @@
 
 #include "config.h"
 
+#ifdef ST_ASIO_HANDLER_ALLOCATOR
+#include <boost/noncopyable.hpp>
+#endif
+
 namespace st_asio_wrapper
 {
 
+#ifdef ST_ASIO_HANDLER_ALLOCATOR
+//recycled memory for the asynchronous operations of one sequence (like the reading or the writing of a socket), asio allocates operations via
+// the associated allocator (handler_allocator) of the completion handler, and frees them before the handler been invoked, so operations
+// of one sequence never overlap (if they do, the heap will be used). the memory block only grows, so after the first few operations,
+// no more heap allocations will happen.
+class handler_memory : public boost::noncopyable
+{
+public:
+	handler_memory() : block(NULL), block_size(0), in_use(false) {}
+	~handler_memory() {::operator delete(block);}
+
+	void* allocate(size_t size)
+	{
+		if (in_use)
+			return ::operator new(size);
+		else if (size > block_size)
+		{
+			::operator delete(block);
+			block = NULL;
+			block_size = 0;
+
+			block = ::operator new(size);
+			block_size = size;
+		}
+
+		in_use = true;
+		return block;
+	}
+
+	void deallocate(void* p)
+	{
+		if (block == p)
+			in_use = false;
+		else
+			::operator delete(p);
+	}
+
+private:
+	void* block;
+	size_t block_size;
+	bool in_use;
+};
+
+template<typename T> class handler_allocator
+{
+public:
+	typedef T value_type;
+
+	explicit handler_allocator(handler_memory& memory_) : memory(&memory_) {}
+	template<typename U> handler_allocator(const handler_allocator<U>& other) : memory(other.memory) {}
+
+	T* allocate(size_t n) const {return static_cast<T*>(memory->allocate(sizeof(T) * n));}
+	void deallocate(T* p, size_t) const {memory->deallocate(p);}
+
+	bool operator==(const handler_allocator& other) const {return memory == other.memory;}
+	bool operator!=(const handler_allocator& other) const {return memory != other.memory;}
+
+private:
+	template<typename> friend class handler_allocator;
+	handler_memory* memory;
+};
+
+//a completion handler (with concrete type, no boost::function) whose operations are allocated from a handler_memory.
+template<typename F> class allocated_handler
+{
+public:
+	typedef handler_allocator<char> allocator_type;
+
+	allocated_handler(handler_memory& memory_, const F& f_) : memory(&memory_), f(f_) {}
+	allocator_type get_allocator() const {return allocator_type(*memory);}
+
+	void operator()(const boost::system::error_code& ec) {f(ec);}
+	void operator()(const boost::system::error_code& ec, size_t bytes_transferred) {f(ec, bytes_transferred);}
+
+private:
+	handler_memory* memory;
+	F f;
+};
+#else
+class handler_memory {}; //placeholder, see macro ST_ASIO_HANDLER_ALLOCATOR
+#endif
+
+#ifdef ST_ASIO_SINGLE_THREAD_CONTEXT
+//each io_context is run by only one thread (see macro ST_ASIO_SINGLE_THREAD_CONTEXT), handlers are already serialized, so a strand
+// is just the executor of the io_context, post goes to the io_context directly, dispatch invokes the handler inline in the service thread.
+class strand_type : public boost::asio::io_context::executor_type
+{
+public:
+	explicit strand_type(boost::asio::io_context& io_context_) : boost::asio::io_context::executor_type(io_context_.get_executor()) {}
+};
+#else
+typedef boost::asio::io_context::strand strand_type;
+#endif
+
 class executor
 {
 protected:
@@ -30,23 +128,31 @@ protected:
 
 public:
 	bool stopped() const {return io_context_.stopped();}
+	boost::asio::io_context& get_io_context() {return io_context_;}
 
 #if BOOST_ASIO_VERSION >= 101100
 	template<typename F> void post(const F& handler) {boost::asio::post(io_context_, handler);}
 	template<typename F> void defer(const F& handler) {boost::asio::defer(io_context_, handler);}
 	template<typename F> void dispatch(const F& handler) {boost::asio::dispatch(io_context_, handler);}
-	template<typename F> void post_strand(boost::asio::io_context::strand& strand, const F& handler) {boost::asio::post(strand, handler);}
-	template<typename F> void defer_strand(boost::asio::io_context::strand& strand, const F& handler) {boost::asio::defer(strand, handler);}
-	template<typename F> void dispatch_strand(boost::asio::io_context::strand& strand, const F& handler) {boost::asio::dispatch(strand, handler);}
+	template<typename F> void post_strand(strand_type& strand, const F& handler) {boost::asio::post(strand, handler);}
+	template<typename F> void defer_strand(strand_type& strand, const F& handler) {boost::asio::defer(strand, handler);}
+	template<typename F> void dispatch_strand(strand_type& strand, const F& handler) {boost::asio::dispatch(strand, handler);}
 #else
 	template<typename F> void post(const F& handler) {io_context_.post(handler);}
 	template<typename F> void dispatch(const F& handler) {io_context_.dispatch(handler);}
-	template<typename F> void post_strand(boost::asio::io_context::strand& strand, const F& handler) {strand.post(handler);}
-	template<typename F> void dispatch_strand(boost::asio::io_context::strand& strand, const F& handler) {strand.dispatch(handler);}
+	template<typename F> void post_strand(strand_type& strand, const F& handler) {strand.post(handler);}
+	template<typename F> void dispatch_strand(strand_type& strand, const F& handler) {strand.dispatch(handler);}
 #endif
 
 	template<typename F> inline const F& make_handler_error(const F& f) const {return f;}
 	template<typename F> inline const F& make_handler_error_size(const F& f) const {return f;}
+#ifdef ST_ASIO_HANDLER_ALLOCATOR
+	template<typename F> inline allocated_handler<F> make_handler_error(handler_memory& memory, const F& f) const {return allocated_handler<F>(memory, f);}
+	template<typename F> inline allocated_handler<F> make_handler_error_size(handler_memory& memory, const F& f) const {return allocated_handler<F>(memory, f);}
+#else
+	template<typename F> inline const F& make_handler_error(handler_memory&, const F& f) const {return f;}
+	template<typename F> inline const F& make_handler_error_size(handler_memory&, const F& f) const {return f;}
+#endif
 
 protected:
 	boost::asio::io_context& io_context_;
@@ -71,6 +71,8 @@ public:
 
 #ifdef ST_ASIO_SHRINK_SEND_BUFFER
 	typedef size_t fo_calc_shrink_size(Socket*, size_t);
+#endif
+#if defined(ST_ASIO_SHRINK_SEND_BUFFER) || defined(ST_ASIO_MSG_DEADLINE)
 	typedef void fo_on_msg_discard(Socket*, typename Socket::in_container_type&);
 #endif
 
@@ -99,6 +101,8 @@ public:
 #endif
 #ifdef ST_ASIO_SHRINK_SEND_BUFFER
 	register_cb_2(calc_shrink_size, false)
+#endif
+#if defined(ST_ASIO_SHRINK_SEND_BUFFER) || defined(ST_ASIO_MSG_DEADLINE)
 	register_cb_2(on_msg_discard, false)
 #endif
 
@@ -133,6 +137,8 @@ private:
 
 #ifdef ST_ASIO_SHRINK_SEND_BUFFER
 	virtual size_t calc_shrink_size(size_t current_size) call_cb_1_return(Socket, size_t, calc_shrink_size, current_size)
+#endif
+#if defined(ST_ASIO_SHRINK_SEND_BUFFER) || defined(ST_ASIO_MSG_DEADLINE)
 	virtual void on_msg_discard(typename Socket::in_container_type& msg_can) call_cb_1_void(Socket, on_msg_discard, msg_can)
 #endif
 
@@ -160,6 +166,8 @@ private:
 
 #ifdef ST_ASIO_SHRINK_SEND_BUFFER
 	std::pair<boost::function<fo_calc_shrink_size>, bool> cb_calc_shrink_size;
+#endif
+#if defined(ST_ASIO_SHRINK_SEND_BUFFER) || defined(ST_ASIO_MSG_DEADLINE)
 	std::pair<boost::function<fo_on_msg_discard>, bool> cb_on_msg_discard;
 #endif
 };
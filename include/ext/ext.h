@@ -30,6 +30,15 @@
 //define this macro will introduce scatter-gather buffers when doing async read, it's very useful under certain situations (for example, ring buffer).
 //this macro is used by unpackers only, it doesn't belong to st_asio_wrapper.
 
+//#define ST_ASIO_NO_SIMD_SCAN
+//prefix_suffix_unpacker searches the first byte of the suffix with SSE2 or AVX2 (chosen at runtime by cpu detection) on x86 and x86_64
+// (need vc, clang or gcc 4.9 and above), then verifies the candidates with memcmp, define this macro to fall back to the scalar search.
+//this macro is used by unpackers only, it doesn't belong to st_asio_wrapper.
+#if !defined(ST_ASIO_NO_SIMD_SCAN) && (defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) && \
+	(defined(_MSC_VER) || defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || __GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define ST_ASIO_SIMD_SCAN
+#endif
+
 #if BOOST_VERSION == 107900 && (defined(_MSC_VER) || defined(__GXX_EXPERIMENTAL_CXX0X__) || __cplusplus >= 201103L)
 #define pos_list std::list<std::pair<const char*, size_t>> //a workaround for a bug introduced in boost 1.79, used by unpackers
 #else
@@ -272,6 +281,136 @@ protected:
 	unsigned len, cap;
 };
 
+//free list for slabs (see slab_buffer), all threads share it (a slab is only taken after the previous one has been filled up, so a mutex is
+// cheap enough), and it caches at most ST_ASIO_SLAB_CACHE bytes, surplus slabs will be freed immediately.
+//unlike node_pool, there's no per-thread cache, because slabs are big, per-thread caches would hold too much memory.
+template<size_t Size> class slab_pool
+{
+public:
+	static void* allocate()
+	{
+		{
+			boost::lock_guard<boost::mutex> lock(mutex);
+			if (NULL != head)
+			{
+				free_node* node = head;
+				head = node->next;
+				--num;
+				return node;
+			}
+		}
+		return ::operator new(block_size());
+	}
+
+	static void deallocate(void* p)
+	{
+		{
+			boost::lock_guard<boost::mutex> lock(mutex);
+			if ((num + 1) * block_size() <= ST_ASIO_SLAB_CACHE)
+			{
+				free_node* node = (free_node*) p;
+				node->next = head;
+				head = node;
+				++num;
+				return;
+			}
+		}
+		::operator delete(p);
+	}
+
+private:
+	struct free_node {free_node* next;};
+	static size_t block_size() {return Size > sizeof(free_node) ? Size : sizeof(free_node);}
+
+private:
+	//cached slabs are intentionally never freed, see node_pool::global_batches for the reason.
+	static boost::mutex mutex;
+	static free_node* head;
+	static size_t num;
+};
+template<size_t Size> boost::mutex slab_pool<Size>::mutex;
+template<size_t Size> typename slab_pool<Size>::free_node* slab_pool<Size>::head = NULL;
+template<size_t Size> size_t slab_pool<Size>::num = 0;
+
+//a read-only view (like string_view) into a slab, but it holds a reference of the slab, so the slab will not be reused until all views of it
+// have been released, see slicing_unpacker for more details.
+//it's copyable and copying is cheap (just like shared_buffer), but please note that a small view keeps the whole slab alive.
+class slab_buffer
+{
+public:
+	struct slab
+	{
+		slab() {} //don't fill the buffer
+		char buff[ST_ASIO_MSG_BUFFER_SIZE];
+	};
+	typedef boost::shared_ptr<slab> slab_type;
+
+	//slabs come from slab_pool, so they will be recycled when the last view of them has been released
+	static slab_type create_slab() {return boost::allocate_shared<slab>(pooled_allocator<slab, slab_pool>());}
+
+	slab_buffer() : buff(NULL), len(0) {}
+	slab_buffer(const slab_type& _raw_slab, const char* _buff, size_t _len) : _slab(_raw_slab), buff(_buff), len(_len) {}
+
+	const slab_type& raw_slab() const {return _slab;}
+
+	//the following five functions are needed by st_asio_wrapper
+	void clear() {_slab.reset(); buff = NULL; len = 0;}
+	const char* data() const {return buff;}
+	size_t size() const {return len;}
+	bool empty() const {return 0 == len;}
+	void swap(slab_buffer& other) {_slab.swap(other._slab); std::swap(buff, other.buff); std::swap(len, other.len);}
+
+protected:
+	slab_type _slab;
+	const char* buff;
+	size_t len;
+};
+
+//LEB128 style length, used by varint_packer and varint_unpacker, 7 bits per byte (little endian), the highest bit means more bytes follow.
+//the value is the length of the body (the header itself is not included, because its length depends on the value),
+// messages shorter than 128 bytes only need one byte header, and since ST_ASIO_MSG_BUFFER_SIZE is not bigger than 100M, 4 bytes are enough.
+class varint_header
+{
+public:
+	static const size_t MAX_LEN = 4;
+
+	static size_t size(size_t value)
+	{
+		size_t head_len = 1;
+		for (; value >= 0x80; value >>= 7)
+			++head_len;
+
+		return head_len;
+	}
+
+	//buff must be at least MAX_LEN bytes, return the length of the header
+	static size_t encode(size_t value, char* buff)
+	{
+		assert(value <= ST_ASIO_MSG_BUFFER_SIZE);
+
+		size_t head_len = 0;
+		for (; value >= 0x80; value >>= 7)
+			buff[head_len++] = (char) (value | 0x80);
+		buff[head_len++] = (char) value;
+
+		return head_len;
+	}
+
+	//return the length of the header, 0 means not enough data (half-baked header), (size_t) -1 means invalid header.
+	static size_t decode(const char* buff, size_t len, size_t& value)
+	{
+		value = 0;
+		for (size_t i = 0; i < len && i < MAX_LEN; ++i)
+		{
+			value |= (size_t) (buff[i] & 0x7f) << (7 * i);
+			if (0 == (buff[i] & 0x80))
+				return i + 1;
+		}
+
+		return len >= MAX_LEN ? (size_t) -1 : 0;
+	}
+};
+
 }} //namespace
 
 #endif /* ST_ASIO_EXT_H_ */
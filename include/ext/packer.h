@@ -241,6 +241,101 @@ public:
 	virtual size_t raw_data_len(typename super::msg_ctype& msg) const {return msg.size() - ST_ASIO_HEAD_LEN;}
 };
 
+//protocol: varint length + body, see varint_header for more details
+//T can be std::string or basic_buffer
+//small messages only pay one byte for the header, while big ones can still be as big as ST_ASIO_MSG_BUFFER_SIZE (without macro ST_ASIO_HUGE_MSG).
+template<typename T = std::string>
+class varint_packer : public i_packer<T>
+{
+private:
+	typedef i_packer<T> super;
+
+public:
+	static size_t get_max_msg_size() {return ST_ASIO_MSG_BUFFER_SIZE - varint_header::size(ST_ASIO_MSG_BUFFER_SIZE);}
+
+	varint_packer() {char head[varint_header::MAX_LEN]; heartbeat.assign(head, varint_header::encode(0, head));}
+
+	using i_packer<typename super::msg_type>::pack_msg;
+	virtual bool pack_msg(typename super::msg_type& msg, const char* const pstr[], const size_t len[], size_t num, bool native = false)
+	{
+		msg.clear();
+		size_t total_len = packer_helper::msg_size_check(0, pstr, len, num);
+		if ((size_t) -1 == total_len)
+			return false;
+		else if (total_len > 0)
+		{
+			if (!native)
+			{
+				if (total_len > get_max_msg_size())
+				{
+					unified_out::error_out("pack msg error: length exceeded the ST_ASIO_MSG_BUFFER_SIZE!");
+					return false;
+				}
+
+				char head[varint_header::MAX_LEN];
+				size_t head_len = varint_header::encode(total_len, head);
+				msg.reserve(head_len + total_len);
+				msg.append(head, head_len);
+			}
+			else
+				msg.reserve(total_len);
+
+			for (size_t i = 0; i < num; ++i)
+				if (NULL != pstr[i])
+					msg.append(pstr[i], len[i]);
+		} //if (total_len > 0)
+
+		return true;
+	}
+	virtual bool pack_msg(typename super::msg_type& msg, typename super::container_type& msg_can)
+	{
+		if (!pack_header(msg.size(), msg_can))
+			return false;
+
+		msg_can.emplace_back().swap(msg);
+		return true;
+	}
+	virtual bool pack_msg(typename super::msg_type& msg1, typename super::msg_type& msg2, typename super::container_type& msg_can)
+	{
+		if (!pack_header(msg1.size() + msg2.size(), msg_can))
+			return false;
+
+		msg_can.emplace_back().swap(msg1);
+		msg_can.emplace_back().swap(msg2);
+		return true;
+	}
+	virtual bool pack_msg(typename super::container_type& in, typename super::container_type& out)
+	{
+		if (!pack_header(st_asio_wrapper::get_size_in_byte(in), out))
+			return false;
+
+		out.splice(out.end(), in);
+		return true;
+	}
+	virtual bool pack_heartbeat(typename super::msg_type& msg) {msg = heartbeat; return true;}
+
+	//msg must has been packed by this packer with native == false
+	virtual char* raw_data(typename super::msg_type& msg) const {return const_cast<char*>(boost::next(msg.data(), head_len(msg)));}
+	virtual const char* raw_data(typename super::msg_ctype& msg) const {return boost::next(msg.data(), head_len(msg));}
+	virtual size_t raw_data_len(typename super::msg_ctype& msg) const {return msg.size() - head_len(msg);}
+
+private:
+	static bool pack_header(size_t len, typename super::container_type& msg_can)
+	{
+		if (len > get_max_msg_size()) //not considered overflow
+			return false;
+
+		char head[varint_header::MAX_LEN];
+		msg_can.emplace_back(head, varint_header::encode(len, head));
+		return true;
+	}
+
+	static size_t head_len(typename super::msg_ctype& msg) {size_t len; return varint_header::decode(msg.data(), msg.size(), len);}
+
+private:
+	typename super::msg_type heartbeat;
+};
+
 //protocol: fixed length
 class fixed_length_packer : public packer<>
 {
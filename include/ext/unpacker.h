@@ -17,6 +17,16 @@
 
 #include "ext.h"
 
+#ifdef ST_ASIO_SIMD_SCAN
+#ifdef _MSC_VER
+#include <intrin.h>
+#define ST_ASIO_TARGET_AVX2
+#else
+#define ST_ASIO_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#include <immintrin.h>
+#endif
+
 namespace st_asio_wrapper { namespace ext {
 
 class unpacker_helper
@@ -46,6 +56,122 @@ public:
 			unified_out::error_out("unparsed data (current msg length is: " ST_ASIO_SF ") are:\n%s", cur_msg_len, os.str().data());
 		}
 	}
+
+	//find the first c in [mem, mem + len), return NULL if not found
+	typedef const char* (*find_byte_fun)(const char* mem, size_t len, char c);
+	static const char* find_byte_scalar(const char* mem, size_t len, char c)
+	{
+		for (const char* end = mem + len; mem < end; ++mem)
+			if (c == *mem)
+				return mem;
+
+		return NULL;
+	}
+
+#ifdef ST_ASIO_SIMD_SCAN
+	static const char* find_byte_sse2(const char* mem, size_t len, char c)
+	{
+		const char* end = mem + len;
+		__m128i pattern = _mm_set1_epi8(c);
+		for (; end - mem >= 16; mem += 16)
+		{
+			unsigned mask = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) mem), pattern));
+			if (0 != mask)
+				return mem + first_bit(mask);
+		}
+
+		return find_byte_scalar(mem, end - mem, c);
+	}
+
+	static ST_ASIO_TARGET_AVX2 const char* find_byte_avx2(const char* mem, size_t len, char c)
+	{
+		const char* end = mem + len;
+		__m256i pattern = _mm256_set1_epi8(c);
+		for (; end - mem >= 32; mem += 32)
+		{
+			unsigned mask = (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) mem), pattern));
+			if (0 != mask)
+				return mem + first_bit(mask);
+		}
+
+		return find_byte_sse2(mem, end - mem, c);
+	}
+
+	static bool has_avx2()
+	{
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+
+		__cpuid(info, 1);
+		if (0 == (info[2] & (1 << 27)) || 0 == (info[2] & (1 << 28)) || 6 != (_xgetbv(0) & 6)) //osxsave, avx and ymm state saving
+			return false;
+
+		__cpuidex(info, 7, 0);
+		return 0 != (info[1] & (1 << 5));
+#else
+		__builtin_cpu_init();
+		return 0 != __builtin_cpu_supports("avx2");
+#endif
+	}
+#endif
+
+	//the best one of the above find_byte_xxx functions on this cpu
+	static find_byte_fun best_find_byte()
+	{
+#ifdef ST_ASIO_SIMD_SCAN
+		return has_avx2() ? &find_byte_avx2 : &find_byte_sse2;
+#else
+		return &find_byte_scalar;
+#endif
+	}
+
+	static const char* find_byte(const char* mem, size_t len, char c)
+	{
+#ifdef ST_ASIO_SIMD_SCAN
+		static const find_byte_fun fun = best_find_byte(); //cpu detection only once
+		return fun(mem, len, c);
+#else
+		return find_byte_scalar(mem, len, c);
+#endif
+	}
+
+	//like strstr, except support \0 in the middle of mem and sub_mem, search candidates by the first byte of sub_mem with find_fun, then verify them.
+	static const void* memmem(const void* mem, size_t len, const void* sub_mem, size_t sub_len, find_byte_fun find_fun = &find_byte)
+	{
+		if (NULL != mem && NULL != sub_mem && sub_len <= len)
+		{
+			if (0 == sub_len)
+				return mem;
+
+			const char* first = (const char*) sub_mem;
+			const char* next = (const char*) mem;
+			const char* last = next + (len - sub_len); //the last position that sub_mem can start at
+			while (NULL != (next = find_fun(next, last - next + 1, *first)))
+				if (0 == memcmp(next + 1, first + 1, sub_len - 1))
+					return next;
+				else if (next++ == last)
+					break;
+		}
+
+		return NULL;
+	}
+
+private:
+#ifdef ST_ASIO_SIMD_SCAN
+	static unsigned first_bit(unsigned mask)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return (unsigned) index;
+#else
+		return (unsigned) __builtin_ctz(mask);
+#endif
+	}
+#endif
 };
 
 //protocol: length + body
@@ -173,6 +299,423 @@ protected:
 	size_t remain_len; //half-baked msg
 };
 
+//protocol: varint length + body, see varint_header for more details
+//T can be std::string or basic_buffer
+template<typename T = std::string>
+class varint_unpacker : public i_unpacker<T>
+{
+private:
+	typedef i_unpacker<T> super;
+
+public:
+	varint_unpacker() {reset();}
+	size_t current_msg_length() const {return cur_msg_len;} //current msg's total length (include the header), -1 means not available
+
+public:
+	virtual void reset() {cur_msg_len = -1; cur_head_len = remain_len = 0;}
+	virtual void dump_left_data() const {unpacker_helper::dump_left_data(raw_buff.data(), cur_msg_len, remain_len);}
+	virtual bool parse_msg(size_t bytes_transferred, typename super::container_type& msg_can)
+	{
+		//varint length + msg
+		remain_len += bytes_transferred;
+		assert(remain_len <= ST_ASIO_MSG_BUFFER_SIZE);
+
+		const char* pnext = raw_buff.begin();
+		bool unpack_ok = true;
+		while (unpack_ok) //considering sticky package problem, we need a loop
+			if ((size_t) -1 != cur_msg_len)
+			{
+				if (cur_msg_len > ST_ASIO_MSG_BUFFER_SIZE)
+					unpack_ok = false;
+				else if (remain_len >= cur_msg_len) //one msg received
+				{
+					if (cur_msg_len > cur_head_len) //ignore heartbeat
+					{
+						if (ST_THIS stripped())
+							msg_can.emplace_back(boost::next(pnext, cur_head_len), cur_msg_len - cur_head_len);
+						else
+							msg_can.emplace_back(pnext, cur_msg_len);
+					}
+					remain_len -= cur_msg_len;
+					std::advance(pnext, cur_msg_len);
+					cur_msg_len = -1;
+				}
+				else
+					break;
+			}
+			else if (remain_len > 0) //maybe the msg's head been received, sticky package found
+			{
+				int re = parse_head(pnext, remain_len);
+				if (re < 0)
+					unpack_ok = false;
+				else if (0 == re)
+					break;
+			}
+			else
+				break;
+
+		if (pnext == raw_buff.begin()) //we should have at least got one msg.
+			unpack_ok = false;
+		else if (remain_len > 0)
+			memmove(raw_buff.begin(), pnext, remain_len); //left behind unparsed data
+
+		//if unpacking failed, successfully parsed msgs will still returned via msg_can(sticky package), please note.
+		return unpack_ok;
+	}
+
+	//a return value of 0 indicates that the read operation is complete. a non-zero value indicates the maximum number
+	//of bytes to be read on the next call to the stream's async_read_some function. ---boost::asio::async_read
+	//read as many as possible to reduce asynchronous call-back, and don't forget to handle sticky package carefully in parse_msg function.
+	virtual size_t completion_condition(const boost::system::error_code& ec, size_t bytes_transferred)
+	{
+		if (ec)
+			return 0;
+
+		size_t data_len = remain_len + bytes_transferred;
+		assert(data_len <= ST_ASIO_MSG_BUFFER_SIZE);
+
+		if ((size_t) -1 == cur_msg_len) //the msg's head has not been parsed
+		{
+			int re = parse_head(raw_buff.begin(), data_len);
+			if (0 == re) //half-baked head
+				return ST_ASIO_MSG_BUFFER_SIZE;
+			else if (re < 0 || cur_msg_len > ST_ASIO_MSG_BUFFER_SIZE) //invalid msg, stop reading
+				return 0;
+		}
+
+		return data_len >= cur_msg_len ? 0 : ST_ASIO_MSG_BUFFER_SIZE;
+		//read as many as possible except that we have already got an entire msg
+	}
+
+#ifdef ST_ASIO_SCATTERED_RECV_BUFFER
+	//this is just to satisfy the compiler, it's not a real scatter-gather buffer,
+	//if you introduce a ring buffer, then you will have the chance to provide a real scatter-gather buffer.
+	virtual typename super::buffer_type prepare_next_recv() {assert(remain_len < ST_ASIO_MSG_BUFFER_SIZE); return typename super::buffer_type(1, boost::asio::buffer(raw_buff) + remain_len);}
+#elif BOOST_ASIO_VERSION <= 101100
+	virtual typename super::buffer_type prepare_next_recv() {assert(remain_len < ST_ASIO_MSG_BUFFER_SIZE); return boost::asio::buffer(boost::asio::buffer(raw_buff) + remain_len);}
+#else
+	virtual typename super::buffer_type prepare_next_recv() {assert(remain_len < ST_ASIO_MSG_BUFFER_SIZE); return boost::asio::buffer(raw_buff) + remain_len;}
+#endif
+
+	//msg must has been unpacked by this unpacker
+	virtual char* raw_data(typename super::msg_type& msg) const {return const_cast<char*>(ST_THIS stripped() ? msg.data() : boost::next(msg.data(), head_len(msg)));}
+	virtual const char* raw_data(typename super::msg_ctype& msg) const {return ST_THIS stripped() ? msg.data() : boost::next(msg.data(), head_len(msg));}
+	virtual size_t raw_data_len(typename super::msg_ctype& msg) const {return ST_THIS stripped() ? msg.size() : msg.size() - head_len(msg);}
+
+private:
+	//1 means got the head (cur_msg_len and cur_head_len are available), 0 means half-baked head, -1 means invalid head.
+	int parse_head(const char* buff, size_t data_len)
+	{
+		size_t body_len;
+		size_t head_len = varint_header::decode(buff, data_len, body_len);
+		if ((size_t) -1 == head_len)
+			return -1;
+		else if (0 == head_len)
+			return 0;
+
+		cur_head_len = head_len;
+		cur_msg_len = head_len + body_len;
+		return 1;
+	}
+
+	static size_t head_len(typename super::msg_ctype& msg) {size_t len; return varint_header::decode(msg.data(), msg.size(), len);}
+
+protected:
+	boost::array<char, ST_ASIO_MSG_BUFFER_SIZE> raw_buff;
+	size_t cur_msg_len; //-1 means head not received, so msg length is not available.
+	size_t cur_head_len;
+	size_t remain_len; //half-baked msg
+};
+
+#ifdef ST_ASIO_SCATTERED_RECV_BUFFER
+//protocol: length + body
+//T can be std::string or basic_buffer
+//unlike unpacker, raw_buff is used as a ring buffer, so leftover data (half-baked msg) never need to be moved to the front of raw_buff,
+// and prepare_next_recv returns a real scatter-gather buffer (two buffers when the free space wraps around the end of raw_buff).
+//msgs which wrap around the end of raw_buff will be assembled from two parts, others will be copied out just as unpacker does.
+template<typename T = std::string>
+class ring_unpacker : public i_unpacker<T>
+{
+private:
+	typedef i_unpacker<T> super;
+
+public:
+	ring_unpacker() {reset();}
+	size_t current_msg_length() const {return cur_msg_len;} //current msg's total length, -1 means not available
+
+	virtual void reset() {cur_msg_len = -1; begin_pos = remain_len = 0;}
+	virtual void dump_left_data() const
+	{
+		if (0 == remain_len)
+			return;
+
+		std::string data(remain_len, '\0');
+		copy_out(begin_pos, &*data.begin(), remain_len);
+		unpacker_helper::dump_left_data(data.data(), cur_msg_len, remain_len);
+	}
+
+	virtual bool parse_msg(size_t bytes_transferred, typename super::container_type& msg_can)
+	{
+		//length + msg
+		remain_len += bytes_transferred;
+		assert(remain_len <= ST_ASIO_MSG_BUFFER_SIZE);
+
+		bool unpack_ok = true, got_msg = false;
+		while (unpack_ok) //considering sticky package problem, we need a loop
+			if ((size_t) -1 != cur_msg_len)
+			{
+				if (cur_msg_len > ST_ASIO_MSG_BUFFER_SIZE || cur_msg_len < ST_ASIO_HEAD_LEN)
+					unpack_ok = false;
+				else if (remain_len >= cur_msg_len) //one msg received
+				{
+					if (cur_msg_len > ST_ASIO_HEAD_LEN) //ignore heartbeat
+					{
+						size_t skip_len = ST_THIS stripped() ? ST_ASIO_HEAD_LEN : 0;
+						size_t pos = (begin_pos + skip_len) % ST_ASIO_MSG_BUFFER_SIZE, len = cur_msg_len - skip_len;
+						if (pos + len <= ST_ASIO_MSG_BUFFER_SIZE)
+							msg_can.emplace_back(boost::next(raw_buff.begin(), pos), len);
+						else //wrapped around the end of raw_buff
+						{
+							size_t first_len = ST_ASIO_MSG_BUFFER_SIZE - pos;
+							msg_can.emplace_back(boost::next(raw_buff.begin(), pos), first_len);
+							msg_can.back().append(raw_buff.begin(), len - first_len);
+						}
+					}
+
+					begin_pos = (begin_pos + cur_msg_len) % ST_ASIO_MSG_BUFFER_SIZE;
+					remain_len -= cur_msg_len;
+					cur_msg_len = -1;
+					got_msg = true;
+				}
+				else
+					break;
+			}
+			else if (remain_len >= ST_ASIO_HEAD_LEN) //the msg's head been received, sticky package found
+			{
+				parse_head();
+#ifdef ST_ASIO_HUGE_MSG
+				if ((size_t) -1 == cur_msg_len) //avoid dead loop on 32bit system with macro ST_ASIO_HUGE_MSG
+					unpack_ok = false;
+#endif
+			}
+			else
+				break;
+
+		if (0 == remain_len)
+			begin_pos = 0; //to make next receiving use one buffer as possible
+
+		//if unpacking failed, successfully parsed msgs will still returned via msg_can(sticky package), please note.
+		return unpack_ok && got_msg; //we should have at least got one msg.
+	}
+
+	//a return value of 0 indicates that the read operation is complete. a non-zero value indicates the maximum number
+	//of bytes to be read on the next call to the stream's async_read_some function. ---boost::asio::async_read
+	//read as many as possible to reduce asynchronous call-back, and don't forget to handle sticky package carefully in parse_msg function.
+	virtual size_t completion_condition(const boost::system::error_code& ec, size_t bytes_transferred)
+	{
+		if (ec)
+			return 0;
+
+		size_t data_len = remain_len + bytes_transferred;
+		assert(data_len <= ST_ASIO_MSG_BUFFER_SIZE);
+
+		if ((size_t) -1 == cur_msg_len && data_len >= ST_ASIO_HEAD_LEN) //the msg's head been received
+		{
+			parse_head();
+			if (cur_msg_len > ST_ASIO_MSG_BUFFER_SIZE || cur_msg_len < ST_ASIO_HEAD_LEN) //invalid msg, stop reading
+				return 0;
+		}
+
+		return data_len >= cur_msg_len ? 0 : ST_ASIO_MSG_BUFFER_SIZE;
+		//read as many as possible except that we have already got an entire msg
+	}
+
+	virtual typename super::buffer_type prepare_next_recv()
+	{
+		assert(remain_len < ST_ASIO_MSG_BUFFER_SIZE);
+
+		size_t end_pos = (begin_pos + remain_len) % ST_ASIO_MSG_BUFFER_SIZE, free_len = ST_ASIO_MSG_BUFFER_SIZE - remain_len;
+		if (end_pos + free_len <= ST_ASIO_MSG_BUFFER_SIZE)
+			return typename super::buffer_type(1, boost::asio::buffer(boost::next(raw_buff.begin(), end_pos), free_len));
+
+		size_t first_len = ST_ASIO_MSG_BUFFER_SIZE - end_pos;
+		typename super::buffer_type buffers;
+		buffers.push_back(boost::asio::buffer(boost::next(raw_buff.begin(), end_pos), first_len));
+		buffers.push_back(boost::asio::buffer(raw_buff.begin(), free_len - first_len));
+		return buffers;
+	}
+
+	//msg must has been unpacked by this unpacker
+	virtual char* raw_data(typename super::msg_type& msg) const {return const_cast<char*>(ST_THIS stripped() ? msg.data() : boost::next(msg.data(), ST_ASIO_HEAD_LEN));}
+	virtual const char* raw_data(typename super::msg_ctype& msg) const {return ST_THIS stripped() ? msg.data() : boost::next(msg.data(), ST_ASIO_HEAD_LEN);}
+	virtual size_t raw_data_len(typename super::msg_ctype& msg) const {return ST_THIS stripped() ? msg.size() : msg.size() - ST_ASIO_HEAD_LEN;}
+
+private:
+	//copy len bytes from pos of raw_buff to dest, wrap around the end of raw_buff if needed.
+	void copy_out(size_t pos, char* dest, size_t len) const
+	{
+		size_t first_len = std::min(len, (size_t) ST_ASIO_MSG_BUFFER_SIZE - pos);
+		memcpy(dest, boost::next(raw_buff.begin(), pos), first_len);
+		memcpy(boost::next(dest, first_len), raw_buff.begin(), len - first_len);
+	}
+
+	void parse_head()
+	{
+		ST_ASIO_HEAD_TYPE head;
+		copy_out(begin_pos, (char*) &head, ST_ASIO_HEAD_LEN);
+		cur_msg_len = ST_ASIO_HEAD_N2H(head);
+	}
+
+protected:
+	boost::array<char, ST_ASIO_MSG_BUFFER_SIZE> raw_buff;
+	size_t cur_msg_len; //-1 means head not received, so msg length is not available.
+	size_t begin_pos; //where the half-baked msg begins
+	size_t remain_len; //half-baked msg
+};
+#endif
+
+//protocol: length + body
+//msgs will not be copied out from the receive buffer but be sliced from it (see slab_buffer), so one memory allocation and one memory
+// replication per msg have been saved, this unpacker can be used with both on_msg and on_msg_handle.
+//the receive buffer is a slab which is shared by all msgs sliced from it, new data will be appended to the slab until the half-baked msg
+// cannot be held by it any more, then a new slab will be taken from slab_pool (and the half-baked msg will be copied into it), but if no msgs
+// refer to the current slab, it will be reused directly (then this unpacker works just as the default unpacker).
+//with macro ST_ASIO_LAZY_RECV_BUFFER, the slab will be released if no half-baked msg left, so idle links hold no slabs.
+class slicing_unpacker : public i_unpacker<slab_buffer>
+{
+public:
+	slicing_unpacker() {reset();}
+	size_t current_msg_length() const {return cur_msg_len;} //current msg's total length, -1 means not available
+
+public:
+	virtual void reset() {cur_msg_len = -1; begin_pos = remain_len = 0;}
+	virtual void dump_left_data() const {if (raw_slab) unpacker_helper::dump_left_data(boost::next(raw_slab->buff, begin_pos), cur_msg_len, remain_len);}
+	virtual bool parse_msg(size_t bytes_transferred, container_type& msg_can)
+	{
+		//length + msg
+		remain_len += bytes_transferred;
+		assert(begin_pos + remain_len <= ST_ASIO_MSG_BUFFER_SIZE);
+
+		bool unpack_ok = true, got_msg = false;
+		while (unpack_ok) //considering sticky package problem, we need a loop
+			if ((size_t) -1 != cur_msg_len)
+			{
+				if (cur_msg_len > ST_ASIO_MSG_BUFFER_SIZE || cur_msg_len < ST_ASIO_HEAD_LEN)
+					unpack_ok = false;
+				else if (remain_len >= cur_msg_len) //one msg received
+				{
+					const char* pnext = boost::next(raw_slab->buff, begin_pos);
+					if (cur_msg_len > ST_ASIO_HEAD_LEN) //ignore heartbeat
+					{
+						if (stripped())
+							msg_can.emplace_back(raw_slab, boost::next(pnext, ST_ASIO_HEAD_LEN), cur_msg_len - ST_ASIO_HEAD_LEN);
+						else
+							msg_can.emplace_back(raw_slab, pnext, cur_msg_len);
+					}
+
+					begin_pos += cur_msg_len;
+					remain_len -= cur_msg_len;
+					cur_msg_len = -1;
+					got_msg = true;
+				}
+				else
+					break;
+			}
+			else if (remain_len >= ST_ASIO_HEAD_LEN) //the msg's head been received, sticky package found
+			{
+				ST_ASIO_HEAD_TYPE head;
+				memcpy(&head, boost::next(raw_slab->buff, begin_pos), ST_ASIO_HEAD_LEN);
+				cur_msg_len = ST_ASIO_HEAD_N2H(head);
+#ifdef ST_ASIO_HUGE_MSG
+				if ((size_t) -1 == cur_msg_len) //avoid dead loop on 32bit system with macro ST_ASIO_HUGE_MSG
+					unpack_ok = false;
+#endif
+			}
+			else
+				break;
+
+		//we should have at least got one msg, except that the slab is full (then the half-baked msg will be moved into a new slab).
+		if (!got_msg && begin_pos + remain_len < ST_ASIO_MSG_BUFFER_SIZE)
+			unpack_ok = false;
+
+		//if unpacking failed, successfully parsed msgs will still returned via msg_can(sticky package), please note.
+		return unpack_ok;
+	}
+
+	//a return value of 0 indicates that the read operation is complete. a non-zero value indicates the maximum number
+	//of bytes to be read on the next call to the stream's async_read_some function. ---boost::asio::async_read
+	//read as many as possible to reduce asynchronous call-back, and don't forget to handle sticky package carefully in parse_msg function.
+	virtual size_t completion_condition(const boost::system::error_code& ec, size_t bytes_transferred)
+	{
+		if (ec)
+			return 0;
+
+		size_t data_len = remain_len + bytes_transferred;
+		assert(begin_pos + data_len <= ST_ASIO_MSG_BUFFER_SIZE);
+
+		if ((size_t) -1 == cur_msg_len && data_len >= ST_ASIO_HEAD_LEN) //the msg's head been received
+		{
+			ST_ASIO_HEAD_TYPE head;
+			memcpy(&head, boost::next(raw_slab->buff, begin_pos), ST_ASIO_HEAD_LEN);
+			cur_msg_len = ST_ASIO_HEAD_N2H(head);
+			if (cur_msg_len > ST_ASIO_MSG_BUFFER_SIZE || cur_msg_len < ST_ASIO_HEAD_LEN) //invalid msg, stop reading
+				return 0;
+		}
+
+		return data_len >= cur_msg_len ? 0 : ST_ASIO_MSG_BUFFER_SIZE;
+		//read as many as possible except that we have already got an entire msg
+	}
+
+#ifdef ST_ASIO_SCATTERED_RECV_BUFFER
+	virtual buffer_type prepare_next_recv() {size_t free_len = make_room(); return buffer_type(1, boost::asio::buffer(boost::next(raw_slab->buff, begin_pos + remain_len), free_len));}
+#else
+	virtual buffer_type prepare_next_recv() {size_t free_len = make_room(); return boost::asio::buffer(boost::next(raw_slab->buff, begin_pos + remain_len), free_len);}
+#endif
+	//the slab will be recycled after all msgs sliced from it have been released
+	virtual bool release_buffer() {if (remain_len > 0) return false; raw_slab.reset(); begin_pos = 0; return true;}
+	virtual bool can_release_buffer() const {return 0 == remain_len;}
+
+	//msg must has been unpacked by this unpacker
+	virtual char* raw_data(msg_type& msg) const {return const_cast<char*>(stripped() ? msg.data() : boost::next(msg.data(), ST_ASIO_HEAD_LEN));}
+	virtual const char* raw_data(msg_ctype& msg) const {return stripped() ? msg.data() : boost::next(msg.data(), ST_ASIO_HEAD_LEN);}
+	virtual size_t raw_data_len(msg_ctype& msg) const {return stripped() ? msg.size() : msg.size() - ST_ASIO_HEAD_LEN;}
+
+private:
+	//make sure that the half-baked msg can be held by the rest of current slab, return the free space's size.
+	size_t make_room()
+	{
+		if (!raw_slab) //released by release_buffer
+		{
+			raw_slab = slab_buffer::create_slab();
+			assert(0 == begin_pos && 0 == remain_len);
+		}
+		else if (raw_slab.unique()) //no msgs refer to current slab, reuse it
+		{
+			if (begin_pos > 0)
+			{
+				memmove(raw_slab->buff, boost::next(raw_slab->buff, begin_pos), remain_len); //left behind unparsed data
+				begin_pos = 0;
+			}
+		}
+		else if (begin_pos + remain_len >= ST_ASIO_MSG_BUFFER_SIZE || ((size_t) -1 != cur_msg_len && begin_pos + cur_msg_len > ST_ASIO_MSG_BUFFER_SIZE))
+		{
+			slab_buffer::slab_type new_slab = slab_buffer::create_slab();
+			memcpy(new_slab->buff, boost::next(raw_slab->buff, begin_pos), remain_len);
+			raw_slab.swap(new_slab); //current slab will be recycled after all msgs sliced from it have been released
+			begin_pos = 0;
+		}
+
+		assert(begin_pos + remain_len < ST_ASIO_MSG_BUFFER_SIZE);
+		return ST_ASIO_MSG_BUFFER_SIZE - begin_pos - remain_len;
+	}
+
+private:
+	slab_buffer::slab_type raw_slab;
+	size_t cur_msg_len; //-1 means head not received, so msg length is not available.
+	size_t begin_pos; //where the half-baked msg begins
+	size_t remain_len; //half-baked msg
+};
+
 //protocol: length + body
 //this unpacker has a fixed buffer (4000 bytes), if messages can be held in it, then this unpacker works just as the default unpacker,
 // otherwise, a dynamic T will be created to hold big messages, then this unpacker works as the non_copy_unpacker.
@@ -418,6 +961,8 @@ public:
 
 	virtual size_t completion_condition(const boost::system::error_code& ec, size_t bytes_transferred) {return unpacker_.completion_condition(ec, bytes_transferred);}
 	virtual typename super::buffer_type prepare_next_recv() {return unpacker_.prepare_next_recv();}
+	virtual bool release_buffer() {return unpacker_.release_buffer();}
+	virtual bool can_release_buffer() const {return unpacker_.can_release_buffer();}
 
 	//msg must has been unpacked by this unpacker
 	virtual char* raw_data(typename super::msg_type& msg) const {return unpacker_.raw_data(*msg.raw_buffer());}
@@ -547,6 +1092,8 @@ public:
 #else
 	virtual buffer_type prepare_next_recv() {return raw_buff.empty() ? boost::asio::buffer((char*) &head, ST_ASIO_HEAD_LEN) : boost::asio::buffer(raw_buff.data(), raw_buff.size());}
 #endif
+	virtual bool release_buffer() {return 0 == step;} //the head will be received into a member variable, no buffer is held
+	virtual bool can_release_buffer() const {return 0 == step;}
 
 private:
 	ST_ASIO_HEAD_TYPE head;
@@ -647,19 +1194,8 @@ public:
 		return ST_ASIO_MSG_BUFFER_SIZE; //read as many as possible
 	}
 
-	//like strstr, except support \0 in the middle of mem and sub_mem
-	static const void* memmem(const void* mem, size_t len, const void* sub_mem, size_t sub_len)
-	{
-		if (NULL != mem && NULL != sub_mem && sub_len <= len)
-		{
-			size_t valid_len = len - sub_len;
-			for (size_t i = 0; i <= valid_len; ++i, mem = (const char*) mem + 1)
-				if (0 == memcmp(mem, sub_mem, sub_len))
-					return mem;
-		}
-
-		return NULL;
-	}
+	//like strstr, except support \0 in the middle of mem and sub_mem, see unpacker_helper::memmem for more details.
+	static const void* memmem(const void* mem, size_t len, const void* sub_mem, size_t sub_len) {return unpacker_helper::memmem(mem, len, sub_mem, sub_len);}
 
 public:
 	virtual void reset() {cur_msg_len = -1; remain_len = 0;}
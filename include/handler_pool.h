@@ -0,0 +1,103 @@
+/*
+ * handler_pool.h
+ *
+ * a thread pool for dispatching messages, separated from service threads
+ */
+
+#ifndef ST_ASIO_HANDLER_POOL_H_
+#define ST_ASIO_HANDLER_POOL_H_
+
+#include "base.h"
+
+namespace st_asio_wrapper
+{
+
+//dispatch messages (on_msg_handle, on_msg with ST_ASIO_PASSIVE_RECV and everything else in dis_strand) in this pool rather than
+// in service threads (which do the io), so slow business handlers will not delay the networking of unrelated sockets.
+//messages of the same socket are still dispatched in sequence (by dis_strand), while different sockets are dispatched concurrently,
+// all threads run the same io_context, so any idle thread takes the next ready socket.
+//the recv buffer is still the back pressure, if the pool lags behind, the socket stops receiving until its dispatcher consumed enough
+// messages (see macro ST_ASIO_RECV_LOW_WATERMARK), service threads are not blocked, they keep serving other sockets.
+//usage: object_pool::set_handler_pool (for servers and clients) or socket::set_dispatch_io_context (for single sockets),
+// start the pool before the service_pump, and stop it after the service_pump has been stopped.
+class handler_pool : public boost::noncopyable
+{
+public:
+	handler_pool() : real_thread_num(0) {}
+	~handler_pool() {stop();}
+
+	boost::asio::io_context& get_io_context() {return io_context;}
+	int thread_num() const {return real_thread_num;}
+	bool is_running() const {return real_thread_num > 0;}
+
+	//start and stop are not thread safe
+	void start(int thread_num)
+	{
+		if (is_running() || thread_num <= 0)
+			return;
+
+#if BOOST_ASIO_VERSION >= 101100
+		io_context.restart(); //this is needed when restart the pool
+#else
+		io_context.reset(); //this is needed when restart the pool
+#endif
+#if BOOST_ASIO_VERSION > 101100
+		work = boost::make_shared<boost::asio::executor_work_guard<boost::asio::io_context::executor_type> >(io_context.get_executor());
+#else
+		work = boost::make_shared<boost::asio::io_context::work>(boost::ref(io_context));
+#endif
+		threads.reset(new boost::thread_group());
+		for (real_thread_num = 0; real_thread_num < thread_num; ++real_thread_num)
+			threads->create_thread(boost::bind(&handler_pool::run, this));
+		unified_out::info_out("handler pool started with %d threads.", real_thread_num);
+	}
+
+	//all handlers that have been posted will be executed before this function returns.
+	void stop()
+	{
+		if (!is_running())
+			return;
+
+		work.reset();
+		threads->join_all();
+		threads.reset(); //a new group will be created when restart the pool
+		real_thread_num = 0;
+		unified_out::info_out("handler pool end.");
+	}
+
+protected:
+#ifndef ST_ASIO_NO_TRY_CATCH
+	virtual bool on_exception(const std::exception& e)
+	{
+		unified_out::error_out("handler pool exception: %s.", e.what());
+		return true; //continue, if needed, rewrite this to decide whether to continue or not
+	}
+#endif
+
+	void run()
+	{
+#ifdef ST_ASIO_NO_TRY_CATCH
+		io_context.run();
+#else
+		while (true)
+		{
+			try {io_context.run(); break;}
+			catch (const std::exception& e) {if (!on_exception(e)) break;}
+		}
+#endif
+	}
+
+private:
+	boost::asio::io_context io_context;
+#if BOOST_ASIO_VERSION > 101100
+	boost::shared_ptr<boost::asio::executor_work_guard<boost::asio::io_context::executor_type> > work;
+#else
+	boost::shared_ptr<boost::asio::io_context::work> work;
+#endif
+	boost::scoped_ptr<boost::thread_group> threads;
+	int real_thread_num;
+};
+
+} //namespace
+
+#endif /* ST_ASIO_HANDLER_POOL_H_ */
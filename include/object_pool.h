@@ -19,6 +19,7 @@
 #include "executor.h"
 #include "timer.h"
 #include "service_pump.h"
+#include "handler_pool.h"
 
 namespace st_asio_wrapper
 {
@@ -41,9 +42,28 @@ public:
 	static const tid TIMER_END = TIMER_BEGIN + 10;
 
 public:
-	object_pool(service_pump& service_pump_) : i_service(service_pump_), timer<executor>(service_pump_), cur_id(ST_ASIO_START_OBJECT_ID - 1), max_size_(ST_ASIO_MAX_OBJECT_NUM) {}
+	object_pool(service_pump& service_pump_) : i_service(service_pump_), timer<executor>(service_pump_), cur_id(ST_ASIO_START_OBJECT_ID - 1), max_size_(ST_ASIO_MAX_OBJECT_NUM),
+		dis_pool(NULL), object_created(false) {}
 	void set_start_object_id(boost::uint_fast64_t id) {cur_id.store(id - 1, boost::memory_order_relaxed);} //call this right after object_pool been constructed
 
+	//dispatch messages of all objects in pool (NULL means in service threads), see handler_pool for more details.
+	//call this right after object_pool been constructed (before starting the service), existing objects (in use, or in the invalid
+	// object container waiting for reusing) will not be re-pointed, so the call is rejected (return false) once any object has been
+	// created, switching back with NULL included.
+	bool set_handler_pool(handler_pool* pool)
+	{
+		boost::lock_guard<ST_ASIO_SHARED_MUTEX_TYPE> lock(object_can_mutex); //init_object reads dis_pool with this lock
+		if (object_created)
+		{
+			unified_out::error_out("cannot change the handler_pool after objects been created.");
+			return false;
+		}
+
+		dis_pool = pool;
+		return true;
+	}
+	handler_pool* get_handler_pool() const {return dis_pool;}
+
 protected:
 	~object_pool() {}
 
@@ -121,6 +141,14 @@ protected:
 		if (object_ptr)
 		{
 			object_ptr->id(1 + cur_id.fetch_add(1, boost::memory_order_relaxed));
+
+			boost::unique_lock<ST_ASIO_SHARED_MUTEX_TYPE> lock(object_can_mutex); //see set_handler_pool
+			object_created = true;
+			BOOST_AUTO(pool, dis_pool);
+			lock.unlock();
+
+			if (NULL != pool)
+				object_ptr->set_dispatch_io_context(pool->get_io_context());
 			on_create(object_ptr);
 		}
 		else
@@ -362,12 +390,48 @@ public:
 				break;
 	}
 
+	//unlike do_something_to_all, the lock of object_can is only held during taking a snapshot of all objects (grouped by their io_context),
+	// then one task per io_context will be posted to invoke __pred on the objects in that group, so __pred runs in parallel on service threads
+	// and add_object / del_object will not be blocked for a long time.
+	//this function returns before __pred being invoked, so __pred must not hold references to temporary objects, please note.
+	template<typename _Predicate> void do_something_to_all_in_parallel(const _Predicate& __pred)
+	{
+		typedef std::vector<object_type> group_type;
+		std::vector<std::pair<boost::asio::io_context*, boost::shared_ptr<group_type> > > groups;
+
+		ST_ASIO_SHARED_LOCK_TYPE<ST_ASIO_SHARED_MUTEX_TYPE> lock(object_can_mutex);
+		for (BOOST_AUTO(iter, object_can.begin()); iter != object_can.end(); ++iter)
+		{
+			boost::asio::io_context* io_context_ = &iter->second->get_io_context();
+			size_t i = 0;
+			while (i < groups.size() && groups[i].first != io_context_) //the number of io_context is small
+				++i;
+			if (i == groups.size())
+				groups.push_back(std::make_pair(io_context_, boost::make_shared<group_type>()));
+			groups[i].second->push_back(iter->second);
+		}
+		lock.unlock();
+
+		for (BOOST_AUTO(iter, groups.begin()); iter != groups.end(); ++iter)
+#if BOOST_ASIO_VERSION >= 101100
+			boost::asio::post(*iter->first, boost::bind(&object_pool::do_something_to_group, iter->second, boost::function<void(object_ctype&)>(__pred)));
+#else
+			iter->first->post(boost::bind(&object_pool::do_something_to_group, iter->second, boost::function<void(object_ctype&)>(__pred)));
+#endif
+	}
+
 private:
+	//__pred is wrapped by boost::function, otherwise boost::bind will treat it as a nested bind expression
+	static void do_something_to_group(const boost::shared_ptr<std::vector<object_type> >& group, const boost::function<void(object_ctype&)>& __pred)
+		{for (BOOST_AUTO(iter, group->begin()); iter != group->end(); ++iter) __pred(*iter);}
+
 	atomic_uint_fast64 cur_id;
 
 	container_type object_can;
 	ST_ASIO_SHARED_MUTEX_TYPE object_can_mutex;
 	size_t max_size_;
+	handler_pool* dis_pool;
+	bool object_created; //by init_object, protected by object_can_mutex, see set_handler_pool
 
 	//because all objects are dynamic created and stored in object_can, after receiving error occurred (you are recommended to delete the object from object_can,
 	//for example via i_server::del_socket), maybe some other asynchronous calls are still queued in boost::asio::io_context, and will be dequeued in the future,
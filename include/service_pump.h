@@ -15,6 +15,13 @@
 
 #include "base.h"
 
+#ifdef __linux__
+#include <sched.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
 namespace st_asio_wrapper
 {
 
@@ -63,6 +70,7 @@ protected:
 	{
 		boost::asio::io_context io_context;
 		unsigned refs;
+		int cpu, numa_node; //only for thread-per-core mode, the service thread will be pinned to cpu, see set_thread_per_core
 #ifdef ST_ASIO_AVOID_AUTO_STOP_SERVICE
 #if BOOST_ASIO_VERSION > 101100
 		boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work;
@@ -73,9 +81,9 @@ protected:
 		boost::thread_group threads;
 
 #if BOOST_ASIO_VERSION >= 101200
-		context(int concurrency_hint = BOOST_ASIO_CONCURRENCY_HINT_SAFE) : io_context(concurrency_hint), refs(0)
+		context(int concurrency_hint = ST_ASIO_CONCURRENCY_HINT, int cpu_ = -1) : io_context(concurrency_hint), refs(0), cpu(cpu_), numa_node(get_numa_node(cpu_))
 #else
-		context() : refs(0)
+		context() : refs(0), cpu(-1), numa_node(-1)
 #endif
 #ifdef ST_ASIO_AVOID_AUTO_STOP_SERVICE
 #if BOOST_ASIO_VERSION > 101100
@@ -95,14 +103,14 @@ public:
 
 #if BOOST_ASIO_VERSION >= 101200
 #ifdef ST_ASIO_DECREASE_THREAD_AT_RUNTIME
-	service_pump(int concurrency_hint = BOOST_ASIO_CONCURRENCY_HINT_SAFE) : started(false), first(true), real_thread_num(0), del_thread_num(0), single_ctx(true)
+	service_pump(int concurrency_hint = ST_ASIO_CONCURRENCY_HINT) : started(false), first(true), real_thread_num(0), del_thread_num(0), single_ctx(true), per_core(false), local_ctx(&service_pump::not_own)
 		{context_can.emplace_back(concurrency_hint);}
 #else
 	//basically, the parameter multi_ctx is designed to be used by single_service_pump, which means single_service_pump always think it's using multiple io_context
 	//for service_pump, you should use set_io_context_num function instead if you really need multiple io_context.
-	service_pump(int concurrency_hint = BOOST_ASIO_CONCURRENCY_HINT_SAFE, bool multi_ctx = false) : started(false), first(true), single_ctx(!multi_ctx)
+	service_pump(int concurrency_hint = ST_ASIO_CONCURRENCY_HINT, bool multi_ctx = false) : started(false), first(true), single_ctx(!multi_ctx), per_core(false), local_ctx(&service_pump::not_own)
 		{context_can.emplace_back(concurrency_hint);}
-	bool set_io_context_num(int io_context_num, int concurrency_hint = BOOST_ASIO_CONCURRENCY_HINT_SAFE) //call this before construct any services on this service_pump
+	bool set_io_context_num(int io_context_num, int concurrency_hint = ST_ASIO_CONCURRENCY_HINT) //call this before construct any services on this service_pump
 	{
 		if (io_context_num < 1 || is_service_started() || context_can.size() > 1) //can only be called once
 			return false;
@@ -114,14 +122,37 @@ public:
 
 		return true;
 	}
+
+	//thread-per-core mode, one io_context (with concurrency hint 1) per cpu in cpus, the service thread which runs it will be pinned to that cpu,
+	// and (linux only) prefers to allocate memory on the local NUMA node. call this instead of set_io_context_num, and before constructing
+	// any services on this service_pump, the thread_num parameter of start_service and run_service will be ignored (always one thread per cpu).
+	//memory is placed on the NUMA node of the thread who touches it first, and sockets are often created by other threads than the service
+	// thread who will serve them (accepted sockets are created by the acceptor's thread), assign_io_context always balances the load first
+	// (the local NUMA node only breaks ties), so tcp server and client sockets re-create their default unpackers (which hold the receive
+	// buffers) in their own service threads before the first reading (see socket::localize_unpacker), messages received are created
+	// by the unpackers there too, so the receive path of a socket is NUMA-local. other memory allocated when the socket was created
+	// (the socket object itself, its queues' own storage) and messages packed in other threads stay where they were allocated.
+	bool set_thread_per_core(const std::vector<int>& cpus)
+	{
+		if (cpus.empty() || is_service_started() || context_can.size() > 1) //can only be called once
+			return false;
+
+		context_can.clear();
+		for (BOOST_AUTO(iter, cpus.begin()); iter != cpus.end(); ++iter)
+			context_can.emplace_back(1, *iter);
+		single_ctx = false;
+		per_core = true;
+
+		return true;
+	}
 #endif
 #else
 #ifdef ST_ASIO_DECREASE_THREAD_AT_RUNTIME
-	service_pump() : started(false), first(true), real_thread_num(0), del_thread_num(0), single_ctx(true), context_can(1) {}
+	service_pump() : started(false), first(true), real_thread_num(0), del_thread_num(0), single_ctx(true), per_core(false), context_can(1), local_ctx(&service_pump::not_own) {}
 #else
 	//basically, the parameter multi_ctx is designed to be used by single_service_pump, which means single_service_pump always think it's using multiple io_context
 	//for service_pump, you should use set_io_context_num function instead if you really need multiple io_context.
-	service_pump(bool multi_ctx = false) : started(false), first(true), single_ctx(!multi_ctx), context_can(1) {}
+	service_pump(bool multi_ctx = false) : started(false), first(true), single_ctx(!multi_ctx), per_core(false), context_can(1), local_ctx(&service_pump::not_own) {}
 	bool set_io_context_num(int io_context_num) //call this before construct any services on this service_pump
 	{
 		if (io_context_num < 1 || is_service_started() || context_can.size() > 1) //can only be called once
@@ -138,6 +169,7 @@ public:
 	virtual ~service_pump() {stop_service();}
 
 	int get_io_context_num() const {return (int) context_can.size();}
+	bool is_thread_per_core() const {return per_core;}
 	void get_io_context_refs(boost::container::list<unsigned>& refs)
 	{
 		if (!single_ctx)
@@ -154,24 +186,23 @@ public:
 	//according to the implementation, it picks the io_context who has the least references, so the return values are not consistent.
 	operator boost::asio::io_context& () {return assign_io_context();}
 
-	boost::asio::io_context& assign_io_context(bool increase_ref = true) //pick the context which has the least references
+	//pick the context which has the least references, in thread-per-core mode, the local NUMA node breaks ties, see set_thread_per_core
+	boost::asio::io_context& assign_io_context(bool increase_ref = true)
 	{
 		if (single_ctx)
 			return context_can.front().io_context;
 
 		context* ctx = NULL;
-		unsigned refs = 0;
+		int numa_node = per_core ? get_local_numa_node() : -1;
 
 		boost::lock_guard<boost::mutex> lock(context_can_mutex);
 		for (BOOST_AUTO(iter, context_can.begin()); iter != context_can.end(); ++iter)
 		{
-			if (0 == iter->refs || 0 == refs || refs > iter->refs)
-			{
-				refs = iter->refs;
+			if (NULL == ctx || ctx->refs > iter->refs ||
+				(ctx->refs == iter->refs && numa_node >= 0 && numa_node != ctx->numa_node && numa_node == iter->numa_node))
 				ctx = &*iter;
-			}
 
-			if (0 == iter->refs)
+			if (0 == ctx->refs && (numa_node < 0 || numa_node == ctx->numa_node))
 				break;
 		}
 
@@ -334,7 +365,7 @@ public:
 
 	//not thread safe
 #if BOOST_ASIO_VERSION >= 101200
-	void add_service_thread(int thread_num, bool block = false, int io_context_num = 0, int concurrency_hint = BOOST_ASIO_CONCURRENCY_HINT_SAFE)
+	void add_service_thread(int thread_num, bool block = false, int io_context_num = 0, int concurrency_hint = ST_ASIO_CONCURRENCY_HINT)
 #else
 	void add_service_thread(int thread_num, bool block = false, int io_context_num = 0)
 #endif
@@ -379,7 +410,9 @@ public:
 protected:
 	void do_service(int thread_num, bool block = false)
 	{
-		if (thread_num <= 0 || (size_t) thread_num < context_can.size())
+		if (one_thread_per_context())
+			thread_num = (int) context_can.size();
+		else if (thread_num <= 0 || (size_t) thread_num < context_can.size())
 		{
 			unified_out::error_out("thread_num must be bigger than or equal to io_context_num.");
 			return;
@@ -399,6 +432,12 @@ protected:
 #endif
 
 		started = true;
+#ifdef ST_ASIO_COARSE_CLOCK
+		coarse_clock::start();
+#endif
+#ifdef ST_ASIO_TSC_CLOCK
+		tsc_clock::calibrate();
+#endif
 		unified_out::info_out("service pump started.");
 
 		for (BOOST_AUTO(iter, context_can.begin()); iter != context_can.end(); ++iter)
@@ -420,6 +459,10 @@ protected:
 		}
 		do_something_to_all(boost::mem_fn(&i_service::finalize));
 
+#ifdef ST_ASIO_COARSE_CLOCK
+		if (started)
+			coarse_clock::stop();
+#endif
 		started = first = false;
 #ifdef ST_ASIO_DECREASE_THREAD_AT_RUNTIME
 		del_thread_num = 0;
@@ -451,6 +494,9 @@ protected:
 		std::stringstream os;
 		os << "service thread[" << boost::this_thread::get_id() << "] begin.";
 		unified_out::info_out(os.str().data());
+		if (ctx->cpu >= 0)
+			pin_thread(ctx->cpu, ctx->numa_node);
+		local_ctx.reset(ctx); //identify this thread as a service thread of this service_pump, see get_local_numa_node
 
 #ifdef ST_ASIO_DECREASE_THREAD_AT_RUNTIME
 		++real_thread_num;
@@ -489,6 +535,7 @@ protected:
 #else
 		while (true) {try {n += ctx->io_context.run(); break;} catch (const std::exception& e) {if (!on_exception(e)) break;}}
 #endif
+		local_ctx.reset();
 		os.str("");
 		os << "service thread[" << boost::this_thread::get_id() << "] end.";
 		unified_out::info_out(os.str().data());
@@ -500,6 +547,13 @@ protected:
 	DO_SOMETHING_TO_ONE_MUTEX(service_can, service_can_mutex, boost::lock_guard<boost::mutex>)
 
 private:
+	//in thread-per-core mode or with macro ST_ASIO_SINGLE_THREAD_CONTEXT, each io_context is run by only one thread.
+#ifdef ST_ASIO_SINGLE_THREAD_CONTEXT
+	bool one_thread_per_context() const {return true;}
+#else
+	bool one_thread_per_context() const {return per_core;}
+#endif
+
 	context* assign_thread() //pick the context which has the least threads
 	{
 		context* ctx = NULL;
@@ -508,6 +562,9 @@ private:
 		for (BOOST_AUTO(iter, context_can.begin()); iter != context_can.end(); ++iter)
 		{
 			size_t this_num = iter->threads.size();
+			if (one_thread_per_context() && this_num > 0)
+				continue;
+
 			if (0 == this_num || 0 == num || num > this_num)
 			{
 				num = this_num;
@@ -521,6 +578,59 @@ private:
 		return ctx;
 	}
 
+	//the NUMA node of the calling thread if it is a service thread of this service_pump in thread-per-core mode, otherwise -1.
+	int get_local_numa_node() const {const context* ctx = local_ctx.get(); return NULL == ctx ? -1 : ctx->numa_node;}
+	static void not_own(context*) {} //local_ctx doesn't own contexts
+
+	static int get_numa_node(int cpu)
+	{
+#ifdef __linux__
+		if (cpu < 0)
+			return -1;
+
+		char path[64];
+		sprintf(path, "/sys/devices/system/cpu/cpu%d", cpu);
+		DIR* dir = opendir(path);
+		if (NULL == dir)
+			return -1;
+
+		int node = -1;
+		for (struct dirent* entry = readdir(dir); NULL != entry && node < 0; entry = readdir(dir))
+			if (0 == strncmp(entry->d_name, "node", 4) && 1 != sscanf(entry->d_name + 4, "%d", &node))
+				node = -1;
+		closedir(dir);
+
+		return node;
+#else
+		return -1;
+#endif
+	}
+
+	static void pin_thread(int cpu, int numa_node)
+	{
+#ifdef __linux__
+		cpu_set_t cpu_set;
+		CPU_ZERO(&cpu_set);
+		CPU_SET(cpu, &cpu_set);
+		int re = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+		if (0 != re)
+			unified_out::error_out("cannot pin service thread to cpu %d (%d).", cpu, re);
+
+		if (numa_node >= 0 && numa_node < (int) (sizeof(unsigned long) * 8 * 16))
+		{
+			unsigned long node_mask[16] = {0};
+			node_mask[numa_node / (sizeof(unsigned long) * 8)] = 1UL << (numa_node % (sizeof(unsigned long) * 8));
+			if (0 != syscall(SYS_set_mempolicy, 1 /*MPOL_PREFERRED*/, node_mask, sizeof(node_mask) * 8 + 1))
+				unified_out::warning_out("cannot prefer NUMA node %d for service thread on cpu %d.", numa_node, cpu);
+		}
+#elif defined(_MSC_VER)
+		if (cpu >= (int) sizeof(DWORD_PTR) * 8 || 0 == SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) 1 << cpu))
+			unified_out::error_out("cannot pin service thread to cpu %d.", cpu);
+#else
+		unified_out::warning_out("pinning service threads is not supported on this platform, cpu %d is ignored.", cpu);
+#endif
+	}
+
 	void add(object_type i_service_)
 	{
 		assert(NULL != i_service_);
@@ -543,9 +653,10 @@ private:
 	atomic_int_fast32_t del_thread_num;
 #endif
 
-	bool single_ctx;
+	bool single_ctx, per_core;
 	boost::container::list<context> context_can;
 	boost::mutex context_can_mutex;
+	boost::thread_specific_ptr<context> local_ctx; //the context which the calling service thread runs
 };
 
 } //namespace
@@ -17,6 +17,8 @@
 #include "timer.h"
 #include "container.h"
 
+#include <boost/type_traits/is_copy_constructible.hpp>
+
 namespace st_asio_wrapper
 {
 
@@ -29,16 +31,21 @@ private:
 
 public:
 	static const tid TIMER_BEGIN = super::TIMER_END;
-	static const tid TIMER_CHECK_RECV = TIMER_BEGIN;
+	static const tid TIMER_CHECK_RECV = TIMER_BEGIN; //deprecated, not used any more, see macro ST_ASIO_RECV_LOW_WATERMARK
 	static const tid TIMER_DISPATCH_MSG = TIMER_BEGIN + 1;
 	static const tid TIMER_DELAY_CLOSE = TIMER_BEGIN + 2;
 	static const tid TIMER_HEARTBEAT_CHECK = TIMER_BEGIN + 3;
+	static const tid TIMER_SEND_WINDOW = TIMER_BEGIN + 4;
 	static const tid TIMER_END = TIMER_BEGIN + 10;
 
+	//set msg_handling_interval to this to disable TIMER_DISPATCH_MSG, then only resume_dispatch() re-dispatches messages.
+	static const unsigned NO_DISPATCH_TIMER = (unsigned) -1;
+
 protected:
-	socket(boost::asio::io_context& io_context_) : super(io_context_), rw_strand(io_context_), next_layer_(io_context_), dis_strand(io_context_) {first_init();}
+	socket(boost::asio::io_context& io_context_) : super(io_context_), rw_strand(io_context_), next_layer_(io_context_), dis_strand(io_context_),
+		dis_io_context(&io_context_) {first_init();}
 	template<typename Arg> socket(boost::asio::io_context& io_context_, Arg& arg) :
-		super(io_context_), rw_strand(io_context_), next_layer_(io_context_, arg), dis_strand(io_context_) {first_init();}
+		super(io_context_), rw_strand(io_context_), next_layer_(io_context_, arg), dis_strand(io_context_), dis_io_context(&io_context_) {first_init();}
 
 	//helper function, just call it in constructor
 	void first_init()
@@ -46,19 +53,41 @@ protected:
 		_id = -1;
 		packer_ = boost::make_shared<Packer>();
 		unpacker_ = boost::make_shared<Unpacker>();
+		unpacker_thread = boost::this_thread::get_id();
+		localize_unpacker_ = false;
 #ifdef ST_ASIO_SYNC_RECV
 		sr_status = NOT_REQUESTED;
 #endif
 		started_ = false;
 		obsoleted_ = false;
 		dispatching = false;
+		dispatch_deferred = false;
 		recv_idle_began = false;
+#ifndef ST_ASIO_PASSIVE_RECV
+		recv_suspended.store(0, boost::memory_order_relaxed);
+#endif
+		lanes_blocked.store(0, boost::memory_order_relaxed);
 		send_buf_size_ = ST_ASIO_MAX_SEND_BUF;
 		recv_buf_size_ = ST_ASIO_MAX_RECV_BUF;
-		msg_resuming_interval_ = ST_ASIO_MSG_RESUMING_INTERVAL;
+		recv_low_watermark_ = ST_ASIO_RECV_LOW_WATERMARK;
 		msg_handling_interval_ = ST_ASIO_MSG_HANDLING_INTERVAL;
+#ifdef ST_ASIO_SEND_WINDOW
+		send_window_interval_ = ST_ASIO_SEND_WINDOW_INTERVAL;
+		send_window_size_ = ST_ASIO_SEND_WINDOW_SIZE;
+		corked.store(0, boost::memory_order_relaxed);
+#endif
+#ifdef ST_ASIO_BUFFER_BUDGET
+		budget_charged.store(0, boost::memory_order_relaxed);
+#endif
+#ifdef ST_ASIO_SINGLE_THREAD_CONTEXT
+		posted_size.store(0, boost::memory_order_relaxed);
+#endif
 	}
 
+#ifdef ST_ASIO_BUFFER_BUDGET
+	~socket() {buffer_budget::charge(-(boost::int_fast64_t) budget_charged.exchange(0, boost::memory_order_relaxed));}
+#endif
+
 	//guarantee no operations (include asynchronous operations) be performed on this socket during call following reset_next_layer functions.
 #if BOOST_ASIO_VERSION < 101100
 	void reset_next_layer() {reset_next_layer(next_layer_.get_io_service());}
@@ -85,6 +114,9 @@ protected:
 		packer_->reset();
 		unpacker_->reset();
 		clear_sending();
+#ifdef ST_ASIO_SEND_WINDOW
+		corked.store(0, boost::memory_order_relaxed);
+#endif
 #ifdef ST_ASIO_PASSIVE_RECV
 		clear_reading();
 #endif
@@ -93,19 +125,64 @@ protected:
 #endif
 		obsoleted_ = false;
 		dispatching = false;
+		dispatch_deferred = false;
 		recv_idle_began = false;
+#ifndef ST_ASIO_PASSIVE_RECV
+		recv_suspended.store(0, boost::memory_order_relaxed);
+#endif
+		lanes_blocked.store(0, boost::memory_order_relaxed);
 		clear_buffer();
 	}
 
 	void clear_buffer()
 	{
-#ifndef ST_ASIO_DISPATCH_BATCH_MSG
 		dispatching_msg.clear();
-#endif
 		send_buffer.clear();
 		recv_buffer.clear();
+		for (BOOST_AUTO(iter, lanes.begin()); iter != lanes.end(); ++iter)
+			(*iter)->clear();
+#ifdef ST_ASIO_BUFFER_BUDGET
+		charge_buffer_budget();
+#endif
+	}
+
+#ifdef ST_ASIO_BUFFER_BUDGET
+	//synchronize the size of send and recv buffers to the process-wide budget, call it after the buffers changed,
+	// not necessarily every time, a lagging one will be corrected by the next one.
+	//it can be called in any thread concurrently, the sizes will be re-read if another thread charged in the meantime, so a stale size
+	// cannot overwrite a newer one.
+	void charge_buffer_budget()
+	{
+		boost::uint_fast64_t charged = budget_charged.load(boost::memory_order_relaxed), size;
+		do
+			size = buffer_size_in_byte();
+		while (size != charged && !budget_charged.compare_exchange_weak(charged, size, boost::memory_order_relaxed));
+
+		if (size != charged)
+			buffer_budget::charge((boost::int_fast64_t) (size - charged));
 	}
 
+	boost::uint_fast64_t buffer_size_in_byte() const
+	{
+		boost::uint_fast64_t size = send_buffer.size_in_byte() + recv_buffer.size_in_byte();
+		for (BOOST_AUTO(iter, lanes.begin()); iter != lanes.end(); ++iter)
+			size += (*iter)->buffer.size_in_byte();
+
+		return size;
+	}
+#endif
+
+#ifdef ST_ASIO_HANDLER_ALLOCATOR
+	//execute in the IO strand -- rw_strand
+	template<typename F> void post_in_io_strand(const F& handler) {post_strand(rw_strand, handler);}
+	//execute in the IO strand -- rw_strand, or current thead, use it carefully
+	template<typename F> void dispatch_in_io_strand(const F& handler) {dispatch_strand(rw_strand, handler);}
+
+	//execute in the dispatch strand -- dis_strand
+	template<typename F> void post_in_dis_strand(const F& handler) {post_strand(dis_strand, handler);}
+	//execute in the dispatch strand -- dis_strand, or current thead, use it carefully
+	template<typename F> void dispatch_in_dis_strand(const F& handler) {dispatch_strand(dis_strand, handler);}
+#else
 	//execute in the IO strand -- rw_strand
 	void post_in_io_strand(const boost::function<void()>& handler) {post_strand(rw_strand, handler);}
 	//execute in the IO strand -- rw_strand, or current thead, use it carefully
@@ -115,6 +192,7 @@ protected:
 	void post_in_dis_strand(const boost::function<void()>& handler) {post_strand(dis_strand, handler);}
 	//execute in the dispatch strand -- dis_strand, or current thead, use it carefully
 	void dispatch_in_dis_strand(const boost::function<void()>& handler) {dispatch_strand(dis_strand, handler);}
+#endif
 
 public:
 #ifdef ST_ASIO_SYNC_SEND
@@ -127,6 +205,9 @@ public:
 	typedef OutContainer<out_msg> out_container_type;
 	typedef InQueue<in_container_type> in_queue_type;
 	typedef OutQueue<out_container_type> out_queue_type;
+#ifdef ST_ASIO_MSG_DEADLINE
+	typedef typename in_msg::deadline_type msg_deadline;
+#endif
 
 	boost::uint_fast64_t id() const {return _id;}
 	bool is_equal_to(boost::uint_fast64_t id) const {return _id == id;}
@@ -173,9 +254,58 @@ public:
 protected:
 #endif
 	//here we cannot use is_sending(), because we need memory fence
-	void send_msg() {if (is_ready() && 1 != sending.load(boost::memory_order_acquire)) dispatch_in_io_strand(boost::bind(&socket::do_send_msg, this, false));}
+#ifdef ST_ASIO_SEND_WINDOW
+	void send_msg()
+	{
+#ifdef ST_ASIO_SINGLE_THREAD_CONTEXT
+		if (!in_io_thread()) //sending is only changed in the service thread, see test_and_set_sending
+		{
+			post_in_io_strand(boost::bind(&socket::send_msg, this));
+			return;
+		}
+#endif
+#ifdef ST_ASIO_BUFFER_BUDGET
+		charge_buffer_budget();
+#endif
+		if (!is_ready())
+			return;
+		else if (1 == sending.load(boost::memory_order_acquire))
+		{
+			if (1 == corked.load(boost::memory_order_relaxed) && is_send_window_full())
+				flush();
+		}
+		else if (!test_and_set_sending()) //we own the sending now, hold messages until flush() is called (by the timer, or by the user)
+		{
+			corked.store(1, boost::memory_order_release);
+			if (is_send_window_full())
+				flush();
+			else //the timer must be manipulated in rw_strand only, because its expiry (flush) is in rw_strand too, see start_send_window_timer
+				dispatch_in_io_strand(boost::bind(&socket::start_send_window_timer, this));
+		}
+	}
+#else
+	void send_msg()
+	{
+#ifdef ST_ASIO_BUFFER_BUDGET
+		charge_buffer_budget();
+#endif
+		if (is_ready() && 1 != sending.load(boost::memory_order_acquire))
+			dispatch_in_io_strand(boost::bind(&socket::do_send_msg, this, false));
+	}
+#endif
 
 public:
+#ifdef ST_ASIO_SEND_WINDOW
+	//send messages held by the send window immediately, see macro ST_ASIO_SEND_WINDOW for more details.
+	void flush() {if (1 == corked.exchange(0, boost::memory_order_acq_rel)) dispatch_in_io_strand(boost::bind(&socket::do_send_msg, this, true));}
+
+	void send_window_interval(unsigned interval) {send_window_interval_ = interval;}
+	unsigned send_window_interval() const {return send_window_interval_;}
+
+	void send_window_size(size_t size) {send_window_size_ = size;}
+	size_t send_window_size() const {return send_window_size_;}
+#endif
+
 	void start_heartbeat(int interval, int max_absence = ST_ASIO_HEARTBEAT_MAX_ABSENCE)
 	{
 		assert(interval > 0 && max_absence > 0);
@@ -195,7 +325,7 @@ public:
 
 		if (stat.last_recv_time > 0 && is_ready()) //check of last_recv_time is essential, because user may call check_heartbeat before do_start
 		{
-			time_t now = time(NULL);
+			time_t now = statistic::time_now();
 			if (now - stat.last_recv_time >= interval * max_absence)
 				if (!on_heartbeat_error())
 					return false;
@@ -215,18 +345,68 @@ public:
 
 	void send_buf_size(size_t size) {if (size > 0) send_buf_size_ = size;}
 	size_t send_buf_size() const {return send_buf_size_;}
-	float send_buf_usage() const {return (float) send_buffer.size_in_byte() / send_buf_size_;}
+	float send_buf_usage() const {return (float) send_buffer_size_in_byte() / send_buf_size_;}
 
 	void recv_buf_size(size_t size) {if (size > 0) recv_buf_size_ = size;}
 	size_t recv_buf_size() const {return recv_buf_size_;}
 	float recv_buf_usage() const {return (float) recv_buffer.size_in_byte() / recv_buf_size_;}
 
-	void msg_resuming_interval(unsigned interval) {msg_resuming_interval_ = interval;}
-	unsigned msg_resuming_interval() const {return msg_resuming_interval_;}
+	//stopped receiving (because of overflowed recv buffer) will be resumed after the recv buffer dropped to this size (bytes).
+	void recv_low_watermark(size_t size) {recv_low_watermark_ = size;}
+	size_t recv_low_watermark() const {return recv_low_watermark_;}
 
-	void msg_handling_interval(size_t interval) {msg_handling_interval_ = interval;}
+	//deprecated, they do nothing any more, see macro ST_ASIO_RECV_LOW_WATERMARK and recv_low_watermark.
+	void msg_resuming_interval(unsigned) {}
+	unsigned msg_resuming_interval() const {return ST_ASIO_MSG_RESUMING_INTERVAL;}
+
+	//0 means re-dispatch immediately, NO_DISPATCH_TIMER means only resume_dispatch() re-dispatches, see macro ST_ASIO_MSG_HANDLING_INTERVAL.
+	void msg_handling_interval(size_t interval) {msg_handling_interval_ = (unsigned) interval;}
 	size_t msg_handling_interval() const {return msg_handling_interval_;}
 
+	//dispatch messages (on_msg_handle etc.) in io_context_ rather than the io_context this socket belongs to, see handler_pool for more details.
+	//only available before this socket been started (or after it been reset), object_pool::set_handler_pool calls it for all new sockets.
+	bool set_dispatch_io_context(boost::asio::io_context& io_context_)
+	{
+		if (started_ || dispatching)
+			return false;
+#ifdef ST_ASIO_SINGLE_THREAD_CONTEXT
+		else if (&io_context_ != &get_io_context()) //the recv buffer and lanes are not thread safe, see macro ST_ASIO_SINGLE_THREAD_CONTEXT
+		{
+			unified_out::error_out(ST_ASIO_LLF " cannot dispatch messages in another io_context with macro ST_ASIO_SINGLE_THREAD_CONTEXT.", id());
+			return false;
+		}
+#endif
+
+		(&dis_strand)->~strand_type(); new (&dis_strand) strand_type(io_context_);
+		dis_io_context = &io_context_;
+		return dispatch_lanes(lanes.size()); //lanes must be rebuilt within the new io_context
+	}
+
+	//dispatch messages in lane_num lanes rather than one by one in dis_strand, messages are mapped to lanes by dispatch_key(msg) % lane_num,
+	// messages in the same lane are dispatched in sequence, while different lanes are dispatched concurrently (so on_msg_handle must be
+	// thread safe between different lanes), all lanes run in the io_context of dis_strand (see set_dispatch_io_context).
+	//each lane can hold recv_buf_size() / lane_num bytes, if a message's lane is full, the dispatcher waits for it (just like a full recv buffer),
+	// so a slow lane finally stops the receiving of this socket.
+	//statistic.handle_time_sum is not accumulated with lanes, because they run concurrently, while dispatch_delay_sum only covers the recv buffer.
+	//0 means no lanes (the default behavior), only available before this socket been started (or after it been reset), call it in
+	// the constructor of your socket for example.
+	bool dispatch_lanes(size_t lane_num)
+	{
+		if (started_ || dispatching)
+			return false;
+
+		lanes.clear();
+		for (size_t i = 0; i < lane_num; ++i)
+			lanes.push_back(boost::make_shared<dispatch_lane>(boost::ref(*dis_io_context)));
+		return true;
+	}
+	size_t dispatch_lanes() const {return lanes.size();}
+
+	//if on_msg_handle failed (returned false or 0), call this to re-dispatch messages immediately (without waiting for
+	// msg_handling_interval milliseconds), for example, after the reason of the failure (like overflowed send buffer) disappeared.
+	//thread safe, it does nothing if the dispatching is not deferred.
+	void resume_dispatch() {post_in_dis_strand(boost::bind(&socket::do_resume_dispatch, this));}
+
 	//in st_asio_wrapper, it's thread safe to access stat without mutex, because for a specific member of stat, st_asio_wrapper will never access it concurrently.
 	//but user can access stat out of st_asio_wrapper via get_statistic function, although user can only read it, there's still a potential risk (especially
 	// on 32 bit system, most likely, it will not be thread safe), so whether it's thread safe or not depends on boost::chrono::system_clock::duration.
@@ -249,16 +429,46 @@ public:
 	const boost::shared_ptr<const i_unpacker<typename Unpacker::msg_type> >& unpacker() const {return unpacker_;}
 #ifdef ST_ASIO_PASSIVE_RECV
 	//changing unpacker must before calling st_asio_wrapper::socket::recv_msg, and define ST_ASIO_PASSIVE_RECV macro.
-	void unpacker(const boost::shared_ptr<i_unpacker<typename Unpacker::msg_type> >& _unpacker_) {unpacker_ = _unpacker_;}
+	void unpacker(const boost::shared_ptr<i_unpacker<typename Unpacker::msg_type> >& _unpacker_) {unpacker_ = _unpacker_; unpacker_thread = boost::thread::id();}
 #endif
 
+	//the unpacker holds the receive buffer, and memory is placed on the NUMA node of the thread who touches it first, while sockets are
+	// often created by other threads than the service thread who serves them (accepted sockets are created by the acceptor's thread).
+	//with this enabled, if the default unpacker (not replaced by unpacker(...)) was created by another thread, it will be re-created (copied,
+	// so its settings are kept) in rw_strand before the first reading, then its buffer is allocated by the service thread itself.
+	//unpackers which are not copy constructible (see boost::is_copy_constructible, with C++03, derive them from boost::noncopyable) stay
+	// where they are. tcp::generic_server_socket and tcp::generic_client_socket enable it in thread-per-core mode (see
+	// service_pump::set_thread_per_core), call it before starting this socket.
+	void localize_unpacker(bool enable) {localize_unpacker_ = enable;}
+	bool is_unpacker_localized() const {return localize_unpacker_;}
+
 	//if you use can_overflow = true to invoke send_msg or send_native_msg, it will always succeed no matter the sending buffer is overflow or not,
 	//this can exhaust all virtual memory, please pay special attentions.
-	bool is_send_buffer_available() const {return send_buffer.size_in_byte() < send_buf_size_;}
+#ifdef ST_ASIO_BUFFER_BUDGET
+	bool is_send_buffer_available() const {return send_buffer_size_in_byte() < send_buf_size_ && buffer_budget::is_available();}
+#else
+	bool is_send_buffer_available() const {return send_buffer_size_in_byte() < send_buf_size_;}
+#endif
+#ifdef ST_ASIO_SINGLE_THREAD_CONTEXT
+	//messages sent from other threads are posted to the service thread (see post_send_msg), they are counted too before they arrived
+	// at the send buffer, so sending from other threads cannot bypass the send buffer's limitation.
+	size_t send_buffer_size_in_byte() const {return send_buffer.size_in_byte() + posted_size.load(boost::memory_order_relaxed);}
+#else
+	size_t send_buffer_size_in_byte() const {return send_buffer.size_in_byte();}
+#endif
 
 	//if you define macro ST_ASIO_PASSIVE_RECV and call recv_msg greedily, the receiving buffer may overflow, this can exhaust all virtual memory,
 	//to avoid this problem, call recv_msg only if is_recv_buffer_available() returns true.
+#ifdef ST_ASIO_BUFFER_BUDGET
+	//an empty recv buffer holds no budget, so it's always available, this makes sure that all sockets can make progress if the budget ran out.
+	bool is_recv_buffer_available() const
+	{
+		size_t size = recv_buffer.size_in_byte();
+		return size < recv_buf_size_ && (0 == size || buffer_budget::is_available());
+	}
+#else
 	bool is_recv_buffer_available() const {return recv_buffer.size_in_byte() < recv_buf_size_;}
+#endif
 
 	//don't use the packer but insert into send buffer directly
 	bool direct_send_msg(const InMsgType& msg, bool can_overflow = false, bool prior = false)
@@ -268,6 +478,28 @@ public:
 	bool direct_send_msg(list<InMsgType>& msg_can, bool can_overflow = false, bool prior = false)
 		{return can_overflow || shrink_send_buffer() ? do_direct_send_msg(msg_can, prior) : false;}
 
+	//following functions are only available if input queue is lane_queue (see ST_ASIO_INPUT_QUEUE), lane 0 has the lowest priority and
+	// is used by all other send_msg series, see lane_queue for more details.
+	//lanes not less than ST_ASIO_SEND_LANE_NUM are invalid, sending messages to them fails (return false).
+	//don't use the packer but insert into the specified lane of send buffer directly
+	bool direct_send_msg_in_lane(size_t lane, const InMsgType& msg, bool can_overflow = false, bool prior = false)
+		{return can_overflow || shrink_send_buffer() ? do_direct_send_msg_in_lane(lane, msg, prior) : false;}
+	bool direct_send_msg_in_lane(size_t lane, InMsgType& msg, bool can_overflow = false, bool prior = false) //after this call, msg becomes empty, please note.
+		{return can_overflow || shrink_send_buffer() ? do_direct_send_msg_in_lane(lane, msg, prior) : false;}
+	void send_lane_weight(size_t lane, unsigned weight) {send_buffer.lane_weight(lane, weight);}
+	unsigned send_lane_weight(size_t lane) const {return send_buffer.lane_weight(lane);}
+	void send_lane_strict_priority(bool strict) {send_buffer.strict_priority(strict);}
+	bool send_lane_strict_priority() const {return send_buffer.strict_priority();}
+
+#ifdef ST_ASIO_MSG_DEADLINE
+	//don't use the packer but insert into send buffer directly, if the msg is still in send buffer when the deadline is reached,
+	// it will be discarded (see on_msg_discard) rather than being sent.
+	bool direct_send_msg_before(const msg_deadline& deadline, const InMsgType& msg, bool can_overflow = false, bool prior = false)
+		{return can_overflow || shrink_send_buffer() ? do_direct_send_msg_before(deadline, msg, prior) : false;}
+	bool direct_send_msg_before(const msg_deadline& deadline, InMsgType& msg, bool can_overflow = false, bool prior = false) //after this call, msg becomes empty, please note.
+		{return can_overflow || shrink_send_buffer() ? do_direct_send_msg_before(deadline, msg, prior) : false;}
+#endif
+
 #ifdef ST_ASIO_SYNC_SEND
 	//don't use the packer but insert into send buffer directly, then wait the sending to finish, unit of the duration is millisecond, 0 means wait infinitely
 	sync_call_result direct_sync_send_msg(const InMsgType& msg, unsigned duration = 0, bool can_overflow = false, bool prior = false)
@@ -321,11 +553,13 @@ public:
 protected:
 	virtual bool do_start()
 	{
-		stat.last_recv_time = time(NULL);
+		stat.last_recv_time = statistic::time_now();
 #if ST_ASIO_HEARTBEAT_INTERVAL > 0
 		start_heartbeat(ST_ASIO_HEARTBEAT_INTERVAL);
 #endif
 		send_msg(); //send buffer may have msgs, send them
+		if (localize_unpacker_) //before the first reading
+			dispatch_in_io_strand(boost::bind(&socket::do_localize_unpacker, this));
 #if !defined(ST_ASIO_PASSIVE_RECV) || !defined(ST_ASIO_SYNC_RECV)
 		recv_msg();
 #endif
@@ -373,6 +607,9 @@ protected:
 	virtual bool on_msg_handle(OutMsgType& msg)
 		{unified_out::debug_out(ST_ASIO_LLF " recv(" ST_ASIO_SF "): %s", id(), msg.size(), msg.data()); return true;}
 #endif
+	//with dispatch lanes, map msg to a lane (the return value modulo dispatch_lanes()), messages which have the same key keep their sequence,
+	// see dispatch_lanes(size_t) for more details. with macro ST_ASIO_PASSIVE_RECV, msg can be empty.
+	virtual size_t dispatch_key(const OutMsgType& msg) {return 0;}
 
 #ifdef ST_ASIO_WANT_MSG_SEND_NOTIFY
 	//one msg has sent to the kernel buffer, msg is the right msg
@@ -385,16 +622,24 @@ protected:
 	virtual void on_all_msg_send(InMsgType& msg) = 0;
 #endif
 
+#if defined(ST_ASIO_SHRINK_SEND_BUFFER) || defined(ST_ASIO_MSG_DEADLINE)
+	//messages discarded by shrink_send_buffer or because of their deadlines (see macro ST_ASIO_MSG_DEADLINE)
+	virtual void on_msg_discard(in_container_type& msg_can) {}
+#endif
+
 	//return true means send buffer becomes available
 #ifdef ST_ASIO_SHRINK_SEND_BUFFER
 	virtual size_t calc_shrink_size(size_t current_size) {return current_size / 3;}
-	virtual void on_msg_discard(in_container_type& msg_can) {}
 
 	bool shrink_send_buffer()
 	{
 		send_buffer.lock();
 		size_t size = send_buffer.size_in_byte();
+#ifdef ST_ASIO_BUFFER_BUDGET
+		if (size < send_buf_size_ && buffer_budget::is_available()) //if the budget ran out, shrink this socket's send buffer too
+#else
 		if (size < send_buf_size_)
+#endif
 		{
 			send_buffer.unlock();
 			return true;
@@ -409,6 +654,11 @@ protected:
 		send_buffer.move_items_out_(size, msg_can);
 		send_buffer.unlock();
 
+#ifdef ST_ASIO_SYNC_SEND
+		for (BOOST_AUTO(iter, msg_can.begin()); iter != msg_can.end(); ++iter)
+			if (iter->p)
+				iter->p->set_value(NOT_APPLICABLE);
+#endif
 		on_msg_discard(msg_can);
 		return true;
 	}
@@ -417,12 +667,58 @@ protected:
 #endif
 
 #ifdef ST_ASIO_PASSIVE_RECV
+#ifdef ST_ASIO_SINGLE_THREAD_CONTEXT
+	//reading is only changed in the service thread, see test_and_set_sending.
+	void clear_reading() {reading.store(0, boost::memory_order_relaxed);}
+	bool test_and_set_reading() {if (1 == reading.load(boost::memory_order_relaxed)) return true; reading.store(1, boost::memory_order_relaxed); return false;}
+#else
 	void clear_reading() {reading.store(0, boost::memory_order_release);}
 	bool test_and_set_reading() {return 1 == reading.exchange(1, boost::memory_order_acq_rel);}
 #endif
+#endif
 
+#ifdef ST_ASIO_MSG_DEADLINE
+	//move expired msgs out of msg_can and discard them, return true if any msg been discarded
+	bool discard_expired_msg(in_container_type& msg_can)
+	{
+		in_container_type expired_msgs;
+		BOOST_AUTO(now, boost::chrono::steady_clock::now());
+		for (BOOST_AUTO(iter, msg_can.begin()); iter != msg_can.end();)
+			if (iter->expired(now))
+			{
+				expired_msgs.emplace_back().swap(*iter);
+				iter = msg_can.erase(iter);
+			}
+			else
+				++iter;
+
+		return discard_msg(expired_msgs);
+	}
+
+	//dequeue a msg which is not expired from send buffer, expired msgs encountered will be discarded
+	bool try_dequeue_unexpired_msg(in_msg& msg)
+	{
+		in_container_type expired_msgs;
+		BOOST_AUTO(now, boost::chrono::steady_clock::now());
+		bool re;
+		while ((re = send_buffer.try_dequeue(msg)) && msg.expired(now))
+			expired_msgs.emplace_back().swap(msg);
+
+		discard_msg(expired_msgs);
+		return re;
+	}
+#endif
+
+#ifdef ST_ASIO_SINGLE_THREAD_CONTEXT
+	bool in_io_thread() const {return rw_strand.running_in_this_thread();}
+
+	//sending is only changed in the service thread, so neither read-modify-write nor memory fence is needed.
+	void clear_sending() {sending.store(0, boost::memory_order_relaxed);}
+	bool test_and_set_sending() {if (1 == sending.load(boost::memory_order_relaxed)) return true; sending.store(1, boost::memory_order_relaxed); return false;}
+#else
 	void clear_sending() {sending.store(0, boost::memory_order_release);}
 	bool test_and_set_sending() {return 1 == sending.exchange(1, boost::memory_order_acq_rel);}
+#endif
 
 	//subclass notify shutdown event
 	bool close(bool use_close = false) //if not use_close, shutdown (both direction) will be used
@@ -447,7 +743,7 @@ protected:
 			boost::system::error_code ec;
 			use_close ? lowest_layer().close(ec) : lowest_layer().shutdown(boost::asio::socket_base::shutdown_both, ec);
 
-			stat.break_time = time(NULL);
+			stat.break_time = statistic::time_now();
 		}
 
 		if (stopped())
@@ -529,6 +825,9 @@ protected:
 			temp_msg_can.clear();
 
 			recv_buffer.move_items_in(temp_buffer, size_in_byte);
+#ifdef ST_ASIO_BUFFER_BUDGET
+			charge_buffer_budget();
+#endif
 			dispatch_msg();
 		}
 
@@ -539,8 +838,8 @@ protected:
 	{
 		if (msg.empty())
 			unified_out::error_out(ST_ASIO_LLF " found an empty message, please check your packer.", id());
-		else if (prior ? send_buffer.enqueue_front(msg) : send_buffer.enqueue(msg))
-			send_msg();
+		else
+			enqueue_send_msg(msg, prior);
 
 		//even if we meet an empty message (because of too big message or insufficient memory, most likely), we still return true, why?
 		//please think about the function safe_send_(native_)msg, if we keep returning false, it will enter a dead loop.
@@ -552,8 +851,8 @@ protected:
 	{
 		if (msg.empty())
 			unified_out::error_out(ST_ASIO_LLF " found an empty message, please check your packer.", id());
-		else if (prior ? send_buffer.enqueue_front(msg) : send_buffer.enqueue(msg))
-			send_msg();
+		else
+			enqueue_send_msg(msg, prior);
 
 		//even if we meet an empty message (because of too big message or insufficient memory, most likely), we still return true, why?
 		//please think about the function safe_send_(native_)msg, if we keep returning false, it will enter a dead loop.
@@ -561,6 +860,54 @@ protected:
 		return true;
 	}
 
+	bool do_direct_send_msg_in_lane(size_t lane, const InMsgType& msg, bool prior = false)
+	{
+		if (!msg.empty())
+			return enqueue_send_msg_in_lane(lane, msg, prior); //false if lane is invalid, see lane_queue::check_lane
+
+		unified_out::error_out(ST_ASIO_LLF " found an empty message, please check your packer.", id());
+		return true; //see do_direct_send_msg for why we return true even if we meet an empty message
+	}
+
+	bool do_direct_send_msg_in_lane(size_t lane, InMsgType& msg, bool prior = false)
+	{
+		if (!msg.empty())
+			return enqueue_send_msg_in_lane(lane, msg, prior); //false if lane is invalid, see lane_queue::check_lane
+
+		unified_out::error_out(ST_ASIO_LLF " found an empty message, please check your packer.", id());
+		return true; //see do_direct_send_msg for why we return true even if we meet an empty message
+	}
+
+#ifdef ST_ASIO_MSG_DEADLINE
+	bool do_direct_send_msg_before(const msg_deadline& deadline, const InMsgType& msg, bool prior = false)
+	{
+		if (msg.empty())
+			unified_out::error_out(ST_ASIO_LLF " found an empty message, please check your packer.", id());
+		else
+		{
+			in_msg unsent_msg(msg);
+			unsent_msg.deadline = deadline;
+			enqueue_send_msg(unsent_msg, prior);
+		}
+
+		return true; //see do_direct_send_msg for why we return true even if we meet an empty message
+	}
+
+	bool do_direct_send_msg_before(const msg_deadline& deadline, InMsgType& msg, bool prior = false)
+	{
+		if (msg.empty())
+			unified_out::error_out(ST_ASIO_LLF " found an empty message, please check your packer.", id());
+		else
+		{
+			in_msg unsent_msg(msg);
+			unsent_msg.deadline = deadline;
+			enqueue_send_msg(unsent_msg, prior);
+		}
+
+		return true; //see do_direct_send_msg for why we return true even if we meet an empty message
+	}
+#endif
+
 	bool do_direct_send_msg(list<InMsgType>& msg_can, bool prior = false)
 	{
 		size_t size_in_byte = 0;
@@ -570,8 +917,7 @@ protected:
 			size_in_byte += iter->size();
 			temp_buffer.emplace_back().swap(*iter); //with c++0x, this can be emplace_back(*iter)
 		}
-		prior ? send_buffer.move_items_in_front(temp_buffer, size_in_byte) : send_buffer.move_items_in(temp_buffer, size_in_byte);
-		send_msg();
+		move_send_msgs_in(temp_buffer, size_in_byte, prior);
 
 		return true;
 	}
@@ -591,10 +937,8 @@ protected:
 		BOOST_AUTO(p, unused.p);
 		typename in_msg::future f;
 		p->get_future().swap(f);
-		if (!(prior ? send_buffer.enqueue_front(unused) : send_buffer.enqueue(unused)))
+		if (!enqueue_send_msg(unused, prior))
 			return NOT_APPLICABLE;
-
-		send_msg();
 #ifdef BOOST_THREAD_USES_CHRONO
 		return 0 == duration || boost::future_status::ready == f.wait_for(boost::chrono::milliseconds(duration)) ? f.get() : TIMEOUT;
 #else
@@ -616,10 +960,8 @@ protected:
 		BOOST_AUTO(p, unused.p);
 		typename in_msg::future f;
 		p->get_future().swap(f);
-		if (!(prior ? send_buffer.enqueue_front(unused) : send_buffer.enqueue(unused)))
+		if (!enqueue_send_msg(unused, prior))
 			return NOT_APPLICABLE;
-
-		send_msg();
 #ifdef BOOST_THREAD_USES_CHRONO
 		return 0 == duration || boost::future_status::ready == f.wait_for(boost::chrono::milliseconds(duration)) ? f.get() : TIMEOUT;
 #else
@@ -646,18 +988,141 @@ protected:
 		BOOST_AUTO(p, temp_buffer.back().p);
 		typename in_msg::future f;
 		p->get_future().swap(f);
-		prior ? send_buffer.move_items_in_front(temp_buffer, size_in_byte) : send_buffer.move_items_in(temp_buffer, size_in_byte);
-
-		send_msg();
+		move_send_msgs_in(temp_buffer, size_in_byte, prior);
 #ifdef BOOST_THREAD_USES_CHRONO
 		return 0 == duration || boost::future_status::ready == f.wait_for(boost::chrono::milliseconds(duration)) ? f.get() : TIMEOUT;
 #else
 		return 0 == duration || f.timed_wait(boost::posix_time::milliseconds(duration)) ? f.get() : TIMEOUT;
 #endif
 	}
+
+	bool do_direct_async_send_msg(InMsgType& msg, const boost::function<void(sync_call_result)>& callback, bool prior = false)
+	{
+		if (stopped())
+			return false;
+		else if (msg.empty())
+		{
+			unified_out::error_out(ST_ASIO_LLF " found an empty message, please check your packer.", id());
+			return false;
+		}
+
+		in_msg unused(msg, true);
+		unused.p->callback = callback;
+		return enqueue_send_msg(unused, prior);
+	}
 #endif
 
 private:
+	//put messages into the send buffer and start the sending, with macro ST_ASIO_SINGLE_THREAD_CONTEXT, the send buffer can only be touched
+	// in the service thread, so messages sent from other threads will be posted to the io_context of this socket (see post_send_msg).
+	template<typename T> bool enqueue_send_msg(T& msg, bool prior)
+	{
+#ifdef ST_ASIO_SINGLE_THREAD_CONTEXT
+		if (!in_io_thread())
+		{
+			in_msg unsent_msg(msg);
+			post_send_msg(unsent_msg, prior);
+			return true;
+		}
+#endif
+		if (!(prior ? send_buffer.enqueue_front(msg) : send_buffer.enqueue(msg)))
+			return false;
+
+		send_msg();
+		return true;
+	}
+
+	template<typename T> bool enqueue_send_msg_in_lane(size_t lane, T& msg, bool prior)
+	{
+#ifdef ST_ASIO_SINGLE_THREAD_CONTEXT
+		if (!in_io_thread())
+		{
+			if (!send_buffer.check_lane(lane)) //check it before posting, so the caller gets the result
+				return false;
+
+			in_msg unsent_msg(msg);
+			post_send_msg_in_lane(lane, unsent_msg, prior);
+			return true;
+		}
+#endif
+		if (!send_buffer.enqueue_in_lane(lane, msg, prior))
+			return false;
+
+		send_msg();
+		return true;
+	}
+
+	void move_send_msgs_in(in_container_type& msg_can, size_t size_in_byte, bool prior)
+	{
+#ifdef ST_ASIO_SINGLE_THREAD_CONTEXT
+		if (!in_io_thread())
+		{
+			BOOST_AUTO(unsent_msgs, boost::make_shared<in_container_type>());
+			unsent_msgs->splice(unsent_msgs->end(), msg_can);
+			post_send_msgs(unsent_msgs, 0 == size_in_byte ? get_size_in_byte(*unsent_msgs) : size_in_byte, prior);
+			return;
+		}
+#endif
+		if (prior)
+			send_buffer.move_items_in_front(msg_can, size_in_byte);
+		else
+			send_buffer.move_items_in(msg_can, size_in_byte);
+		send_msg();
+	}
+
+#ifdef ST_ASIO_SINGLE_THREAD_CONTEXT
+	//one more post and heap allocation for each message, so send messages in the service thread (like in on_msg_handle) whenever possible.
+	//posted messages are counted by posted_size until they arrived at the send buffer, see send_buffer_size_in_byte.
+	void post_send_msg(in_msg& msg, bool prior)
+	{
+		BOOST_AUTO(unsent_msgs, boost::make_shared<in_container_type>());
+		unsent_msgs->emplace_back().swap(msg);
+		post_send_msgs(unsent_msgs, unsent_msgs->back().size(), prior);
+	}
+
+	void post_send_msgs(const boost::shared_ptr<in_container_type>& unsent_msgs, size_t size_in_byte, bool prior)
+	{
+		posted_size.fetch_add(size_in_byte, boost::memory_order_relaxed);
+		post_in_io_strand(boost::bind(&socket::enqueue_posted_msgs, this, unsent_msgs, size_in_byte, prior));
+	}
+
+	void post_send_msg_in_lane(size_t lane, in_msg& msg, bool prior)
+	{
+		BOOST_AUTO(unsent_msgs, boost::make_shared<in_container_type>());
+		unsent_msgs->emplace_back().swap(msg);
+		posted_size.fetch_add(unsent_msgs->back().size(), boost::memory_order_relaxed);
+		post_in_io_strand(boost::bind(&socket::enqueue_posted_msg_in_lane, this, lane, unsent_msgs, prior));
+	}
+
+	void enqueue_posted_msgs(const boost::shared_ptr<in_container_type>& unsent_msgs, size_t size_in_byte, bool prior)
+	{
+		posted_size.fetch_sub(size_in_byte, boost::memory_order_relaxed);
+		move_send_msgs_in(*unsent_msgs, size_in_byte, prior);
+	}
+	void enqueue_posted_msg_in_lane(size_t lane, const boost::shared_ptr<in_container_type>& unsent_msgs, bool prior)
+	{
+		posted_size.fetch_sub(unsent_msgs->front().size(), boost::memory_order_relaxed);
+		enqueue_send_msg_in_lane(lane, unsent_msgs->front(), prior);
+	}
+#endif
+
+	//see localize_unpacker, in rw_strand
+	void do_localize_unpacker()
+	{
+		if (boost::thread::id() != unpacker_thread && boost::this_thread::get_id() != unpacker_thread)
+			copy_unpacker(boost::is_copy_constructible<Unpacker>());
+	}
+	void copy_unpacker(const boost::true_type&)
+	{
+		try
+		{
+			unpacker_ = boost::make_shared<Unpacker>(*static_cast<const Unpacker*>(unpacker_.get()));
+			unpacker_thread = boost::this_thread::get_id();
+		}
+		catch (const std::exception& e) {unified_out::error_out(ST_ASIO_LLF " cannot re-create the unpacker (%s), keep the old one.", id(), e.what());}
+	}
+	void copy_unpacker(const boost::false_type&) {}
+
 	virtual void do_recv_msg() = 0;
 	virtual bool do_send_msg(bool in_strand = false) = 0;
 
@@ -667,6 +1132,23 @@ private:
 	template<typename> friend class single_socket_service;
 	void id(boost::uint_fast64_t id) {_id = id;}
 
+#ifdef ST_ASIO_MSG_DEADLINE
+	bool discard_msg(in_container_type& expired_msgs)
+	{
+		if (expired_msgs.empty())
+			return false;
+
+#ifdef ST_ASIO_SYNC_SEND
+		for (BOOST_AUTO(iter, expired_msgs.begin()); iter != expired_msgs.end(); ++iter)
+			if (iter->p)
+				iter->p->set_value(NOT_APPLICABLE);
+#endif
+		stat.send_expired_sum += expired_msgs.size();
+		on_msg_discard(expired_msgs);
+		return true;
+	}
+#endif
+
 	void reset_next_layer(boost::asio::io_context& io_context) {(&next_layer_)->~Socket(); new (&next_layer_) Socket(io_context);}
 	template<typename Arg>
 	void reset_next_layer(boost::asio::io_context& io_context, Arg& arg) {(&next_layer_)->~Socket(); new (&next_layer_) Socket(io_context, arg);}
@@ -720,16 +1202,34 @@ private:
 		if (check_receiving(false))
 			return true;
 
-		set_timer(TIMER_CHECK_RECV, msg_resuming_interval_, boost::lambda::if_then_else_return(boost::lambda::bind(&socket::check_receiving, this, true), false, true));
+		//receiving will be resumed by the dispatcher (see resume_receiving), but the dispatcher may have consumed messages
+		// before we set the flag, so check again.
+		recv_suspended.store(1, boost::memory_order_seq_cst);
+		if (is_recv_buffer_available() && 1 == recv_suspended.exchange(0, boost::memory_order_seq_cst))
+			return check_receiving(false) || handled_msg();
 #endif
 		return false;
 	}
 
+#ifndef ST_ASIO_PASSIVE_RECV
+	//called by the dispatcher after messages been consumed, resume the stopped receiving if the recv buffer dropped to the low watermark.
+	void resume_receiving()
+	{
+		if (1 == recv_suspended.load(boost::memory_order_seq_cst) && recv_buffer.size_in_byte() <= recv_low_watermark_ && is_recv_buffer_available() &&
+			1 == recv_suspended.exchange(0, boost::memory_order_seq_cst))
+			post_in_io_strand(boost::bind(&socket::do_resume_receiving, this));
+	}
+	void do_resume_receiving() {if (is_ready() && handled_msg()) do_recv_msg();}
+#endif
+
 	//do not use dispatch_strand/dispatch_in_dis_strand at here, because the handler (do_dispatch_msg) may call this function, which can lead stack overflow.
 	void dispatch_msg() {if (!dispatching) post_in_dis_strand(boost::bind(&socket::do_dispatch_msg, this));}
 	void accumulate_dispatch_delay(const statistic::stat_time& begin_time, const out_msg& msg) {stat.dispatch_delay_sum += begin_time - msg.begin_time;}
 	void do_dispatch_msg()
 	{
+		if (!lanes.empty())
+			return dispatch_to_lanes();
+
 #ifdef ST_ASIO_DISPATCH_BATCH_MSG
 		if (!recv_buffer.is_empty())
 		{
@@ -747,7 +1247,7 @@ private:
 #ifdef ST_ASIO_FULL_STATISTIC
 				recv_buffer.do_something_to_all(boost::bind(&out_msg::restart, boost::placeholders::_1, boost::cref(end_time)));
 #endif
-				set_timer(TIMER_DISPATCH_MSG, msg_handling_interval_, boost::bind(&socket::timer_handler, this, boost::placeholders::_1)); //hold dispatching
+				defer_dispatch();
 			}
 			else
 			{
@@ -764,27 +1264,165 @@ private:
 			if (!re) //dispatch failed, re-dispatch
 			{
 				dispatching_msg.restart(end_time);
-				set_timer(TIMER_DISPATCH_MSG, msg_handling_interval_, boost::bind(&socket::timer_handler, this, boost::placeholders::_1)); //hold dispatching
+				defer_dispatch();
 			}
 			else
 			{
 				dispatching_msg.clear();
 #endif
 				dispatching = false;
+#ifdef ST_ASIO_BUFFER_BUDGET
+				charge_buffer_budget();
+#endif
 				post_in_dis_strand(boost::bind(&socket::do_dispatch_msg, this)); //dispatch msg in sequence
 			}
+#ifndef ST_ASIO_PASSIVE_RECV
+			resume_receiving();
+#endif
 		}
 		else
 			dispatching = false;
 	}
 
+	//hold dispatching until resume_dispatch() been called or msg_handling_interval milliseconds elapsed (NO_DISPATCH_TIMER means no timer).
+	void defer_dispatch()
+	{
+		dispatch_deferred = true;
+		if (NO_DISPATCH_TIMER != msg_handling_interval_)
+			start_dispatch_timer();
+	}
+	void start_dispatch_timer() {set_timer(TIMER_DISPATCH_MSG, msg_handling_interval_, boost::bind(&socket::timer_handler, this, boost::placeholders::_1));}
+	//both resume_dispatch and the timer come here (in dis_strand), only the first one re-dispatches.
+	void do_resume_dispatch()
+	{
+		for (BOOST_AUTO(iter, lanes.begin()); iter != lanes.end(); ++iter)
+			if (1 == (*iter)->deferred.load(boost::memory_order_relaxed))
+				post_strand((*iter)->strand, boost::bind(&socket::do_resume_lane, this, iter->get()));
+
+		if (dispatch_deferred)
+		{
+			dispatch_deferred = false;
+			do_dispatch_msg();
+		}
+	}
+
+	struct dispatch_lane
+	{
+		dispatch_lane(boost::asio::io_context& io_context_) : strand(io_context_) {clear();}
+		void clear()
+		{
+			buffer.clear();
+			dispatching_msg.clear();
+			dispatching = false;
+			scheduled.store(0, boost::memory_order_relaxed);
+			deferred.store(0, boost::memory_order_relaxed);
+		}
+
+		strand_type strand;
+		out_queue_type buffer;
+		out_msg dispatching_msg;
+		bool dispatching; //only accessed in strand
+		atomic_size_t scheduled; //a handler has been posted to the strand or the lane has been deferred
+		atomic_size_t deferred; //on_msg_handle failed, waiting for resume_dispatch() or the timer
+	};
+
+	//the dispatcher (in dis_strand) moves messages from recv_buffer to lanes, on_msg_handle is invoked in lanes.
+	//dispatching and dispatching_msg hold the message which is waiting for its full lane.
+	void dispatch_to_lanes()
+	{
+		size_t lane_buf_size = std::max(recv_buf_size_ / lanes.size(), (size_t) 1);
+		while (dispatching || recv_buffer.try_dequeue(dispatching_msg))
+		{
+			if (!dispatching)
+			{
+				dispatching = true;
+				dispatching_lane = dispatch_key(dispatching_msg) % lanes.size();
+			}
+
+			dispatch_lane* lane = lanes[dispatching_lane].get();
+			if (lane->buffer.size_in_byte() >= lane_buf_size)
+			{
+				lanes_blocked.store(1, boost::memory_order_seq_cst);
+				if (lane->buffer.size_in_byte() >= lane_buf_size) //check again, the lane may has been consumed before lanes_blocked was set
+				{
+					defer_dispatch();
+					break;
+				}
+			}
+
+			stat.dispatch_delay_sum += statistic::now() - dispatching_msg.begin_time;
+			lane->buffer.enqueue(dispatching_msg);
+			dispatching = false;
+			dispatch_lane_msg(lane);
+		}
+
+#ifdef ST_ASIO_BUFFER_BUDGET
+		charge_buffer_budget();
+#endif
+#ifndef ST_ASIO_PASSIVE_RECV
+		resume_receiving();
+#endif
+	}
+
+	void dispatch_lane_msg(dispatch_lane* lane)
+		{if (0 == lane->scheduled.exchange(1, boost::memory_order_seq_cst)) post_strand(lane->strand, boost::bind(&socket::do_dispatch_lane, this, lane));}
+	void do_dispatch_lane(dispatch_lane* lane)
+	{
+#ifdef ST_ASIO_DISPATCH_BATCH_MSG
+		if (!lane->buffer.is_empty())
+		{
+			bool re = on_msg_handle(lane->buffer) > 0;
+#else
+		if (lane->dispatching || lane->buffer.try_dequeue(lane->dispatching_msg))
+		{
+			lane->dispatching = true;
+			bool re = on_msg_handle(lane->dispatching_msg); //must before next msg dispatching to keep sequence
+#endif
+			if (1 == lanes_blocked.load(boost::memory_order_seq_cst) && 1 == lanes_blocked.exchange(0, boost::memory_order_seq_cst))
+				resume_dispatch(); //the dispatcher is waiting for a full lane, maybe this one
+
+			if (!re) //dispatch failed, re-dispatch after resume_dispatch() been called or msg_handling_interval milliseconds elapsed
+			{
+				lane->deferred.store(1, boost::memory_order_relaxed);
+				if (NO_DISPATCH_TIMER != msg_handling_interval_)
+					post_in_dis_strand(boost::bind(&socket::start_dispatch_timer, this));
+			}
+			else
+			{
+#ifndef ST_ASIO_DISPATCH_BATCH_MSG
+				lane->dispatching_msg.clear();
+				lane->dispatching = false;
+#endif
+				post_strand(lane->strand, boost::bind(&socket::do_dispatch_lane, this, lane)); //dispatch msg in sequence
+			}
+		}
+		else
+		{
+			lane->scheduled.store(0, boost::memory_order_seq_cst);
+			if (!lane->buffer.is_empty()) //the dispatcher may have put messages into this lane before scheduled was cleared
+				dispatch_lane_msg(lane);
+		}
+	}
+	void do_resume_lane(dispatch_lane* lane) {if (1 == lane->deferred.exchange(0, boost::memory_order_relaxed)) do_dispatch_lane(lane);}
+
+#ifdef ST_ASIO_SEND_WINDOW
+	//send_msg may be called in any thread, while manipulating the same timer concurrently is not thread safe (see timer), so TIMER_SEND_WINDOW
+	// is only started in rw_strand and its call_back is called in rw_strand too.
+	void start_send_window_timer() {set_timer(rw_strand, TIMER_SEND_WINDOW, send_window_interval_, boost::bind(&socket::timer_handler, this, boost::placeholders::_1));}
+#endif
+
 	bool timer_handler(tid id)
 	{
 		switch (id)
 		{
 		case TIMER_DISPATCH_MSG:
-			post_in_dis_strand(boost::bind(&socket::do_dispatch_msg, this));
+			post_in_dis_strand(boost::bind(&socket::do_resume_dispatch, this));
+			break;
+#ifdef ST_ASIO_SEND_WINDOW
+		case TIMER_SEND_WINDOW:
+			flush();
 			break;
+#endif
 		case TIMER_DELAY_CLOSE:
 			{
 				int re = is_last_async_call();
@@ -822,20 +1460,22 @@ protected:
 	list<OutMsgType> temp_msg_can;
 
 	in_queue_type send_buffer;
-	boost::asio::io_context::strand rw_strand;
+	strand_type rw_strand;
+	handler_memory reading_memory, sending_memory; //for the asynchronous reading and writing, see macro ST_ASIO_HANDLER_ALLOCATOR
 
 private:
 	boost::shared_ptr<i_packer<typename Packer::msg_type> > packer_;
 	boost::shared_ptr<i_unpacker<typename Unpacker::msg_type> > unpacker_;
+	boost::thread::id unpacker_thread; //who created the default unpacker, not-a-thread means it has been replaced, see localize_unpacker
+	bool localize_unpacker_;
 
 	bool recv_idle_began;
 	volatile bool started_; //has started or not
 	volatile bool obsoleted_;
 
 	volatile bool dispatching;
-#ifndef ST_ASIO_DISPATCH_BATCH_MSG
+	bool dispatch_deferred; //only accessed in dis_strand
 	out_msg dispatching_msg;
-#endif
 
 	typename statistic::stat_time recv_idle_begin_time;
 	out_queue_type recv_buffer;
@@ -847,8 +1487,19 @@ private:
 	atomic_size_t reading;
 #endif
 	atomic_size_t sending;
+#ifdef ST_ASIO_SINGLE_THREAD_CONTEXT
+	atomic_size_t posted_size; //messages (bytes) posted from other threads, see post_send_msg
+#endif
+#ifndef ST_ASIO_PASSIVE_RECV
+	atomic_size_t recv_suspended; //receiving stopped because of overflowed recv buffer, the dispatcher will resume it
+#endif
 	atomic_flag start_atomic;
-	boost::asio::io_context::strand dis_strand;
+	strand_type dis_strand;
+	boost::asio::io_context* dis_io_context; //where dis_strand and lanes belong to
+
+	std::vector<boost::shared_ptr<dispatch_lane> > lanes;
+	size_t dispatching_lane; //the lane of dispatching_msg, only accessed in dis_strand
+	atomic_size_t lanes_blocked; //the dispatcher is waiting for a full lane
 
 #ifdef ST_ASIO_SYNC_RECV
 	enum sync_recv_status {NOT_REQUESTED, REQUESTED, RESPONDED, RESPONDED_FAILURE};
@@ -858,8 +1509,19 @@ private:
 	condition_variable sync_recv_cv;
 #endif
 
-	size_t send_buf_size_, recv_buf_size_;
-	unsigned msg_resuming_interval_, msg_handling_interval_;
+	size_t send_buf_size_, recv_buf_size_, recv_low_watermark_;
+#ifdef ST_ASIO_BUFFER_BUDGET
+	atomic_uint_fast64 budget_charged; //how many bytes this socket has charged to the buffer_budget
+#endif
+	unsigned msg_handling_interval_;
+
+#ifdef ST_ASIO_SEND_WINDOW
+	bool is_send_window_full() const {return send_window_size_ > 0 && send_buffer.size_in_byte() >= send_window_size_;}
+
+	atomic_size_t corked; //held by the send window, sending is also set during this period
+	unsigned send_window_interval_;
+	size_t send_window_size_;
+#endif
 };
 
 } //namespace
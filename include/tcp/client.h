@@ -74,6 +74,14 @@ public:
 	//msg sending interface
 	TCP_BROADCAST_MSG(broadcast_msg, send_msg)
 	TCP_BROADCAST_MSG(broadcast_native_msg, send_native_msg)
+	//pack msg only once, see macro TCP_SHARED_BROADCAST_MSG for more details
+	TCP_DIRECT_BROADCAST_MSG(direct_broadcast_msg)
+	TCP_SHARED_BROADCAST_MSG(shared_broadcast_msg, direct_broadcast_msg, false)
+	TCP_SHARED_BROADCAST_MSG(shared_broadcast_native_msg, direct_broadcast_msg, true)
+	//pack msg only once and broadcast it in parallel (one task per io_context), see object_pool::do_something_to_all_in_parallel for more details
+	TCP_PARALLEL_DIRECT_BROADCAST_MSG(parallel_direct_broadcast_msg)
+	TCP_SHARED_BROADCAST_MSG(parallel_broadcast_msg, parallel_direct_broadcast_msg, false)
+	TCP_SHARED_BROADCAST_MSG(parallel_broadcast_native_msg, parallel_direct_broadcast_msg, true)
 	//guarantee send msg successfully even if can_overflow equal to false
 	//success at here just means put the msg into tcp::socket_base's send buffer
 	TCP_BROADCAST_MSG(safe_broadcast_msg, safe_send_msg)
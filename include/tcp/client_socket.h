@@ -117,7 +117,13 @@ public:
 
 protected:
 	//helper function, just call it in constructor
-	void first_init(Matrix* matrix_ = NULL) {need_reconnect = ST_ASIO_RECONNECT; matrix = matrix_;}
+	void first_init(Matrix* matrix_ = NULL)
+	{
+		need_reconnect = ST_ASIO_RECONNECT;
+		matrix = matrix_;
+		if (NULL != matrix)
+			ST_THIS localize_unpacker(matrix->get_service_pump().is_thread_per_core());
+	}
 
 	Matrix* get_matrix() {return matrix;}
 	const Matrix* get_matrix() const {return matrix;}
@@ -0,0 +1,285 @@
+/*
+ * coroutine_socket.h
+ *
+ * C++20 coroutine interfaces (co_await connect, send_msg and recv_msg) for tcp sockets
+ */
+
+#ifndef ST_ASIO_TCP_COROUTINE_SOCKET_H_
+#define ST_ASIO_TCP_COROUTINE_SOCKET_H_
+
+#include <coroutine>
+
+#include "socket.h"
+
+#ifndef __cpp_impl_coroutine
+	#error coroutine_socket needs C++20 coroutines, please compile with -std=c++20 or higher.
+#endif
+#ifndef ST_ASIO_SYNC_SEND
+	#error coroutine_socket needs macro ST_ASIO_SYNC_SEND (it waits the sending results asynchronously).
+#endif
+#ifdef ST_ASIO_SYNC_DISPATCH
+	#error coroutine_socket receives messages in on_msg_handle, do not define macro ST_ASIO_SYNC_DISPATCH.
+#endif
+
+namespace st_asio_wrapper { namespace tcp {
+
+//a coroutine which starts immediately and destroys itself at the end, nobody can wait for it.
+//an exception which escapes from the coroutine is logged and swallowed, then the coroutine ends (and its frame is destroyed) normally,
+// rethrowing it would leak the frame and unwind the dispatching (on_msg_handle for example) who resumed the coroutine, so catch
+// exceptions in the coroutine if you want to handle them.
+struct detached_coroutine
+{
+	struct promise_type
+	{
+		detached_coroutine get_return_object() {return detached_coroutine();}
+		std::suspend_never initial_suspend() noexcept {return std::suspend_never();}
+		std::suspend_never final_suspend() noexcept {return std::suspend_never();}
+		void return_void() {}
+		void unhandled_exception()
+		{
+			try {throw;}
+			catch (const std::exception& e) {unified_out::error_out("coroutine ended with an exception (%s).", e.what());}
+			catch (...) {unified_out::error_out("coroutine ended with an unknown exception.");}
+		}
+	};
+};
+
+//Socket is a tcp::client_socket_base or tcp::server_socket_base (or their subclasses), usage:
+// class my_socket : public coroutine_socket<client_socket> {...};
+// detached_coroutine session(my_socket& socket)
+// {
+//	if (!co_await socket.connect()) //client endpoint only
+//		co_return;
+//	while (SUCCESS == co_await socket.send_msg(request))
+//	{
+//		out_msg_type msg = co_await socket.recv_msg();
+//		if (msg.empty()) //link broken
+//			break;
+//		...
+//	}
+// }
+//no threads will be blocked, connect, send_msg and recv_msg resume the coroutine in dis_strand (so in service threads or the handler_pool),
+// so one coroutine per socket is expected, and the coroutine must not outlive the socket (use macro ST_ASIO_REUSE_OBJECT).
+//recv_msg takes messages in on_msg_handle, if no coroutine is waiting, the dispatching is deferred (without timer, see socket::NO_DISPATCH_TIMER)
+// until the next recv_msg, so the recv buffer is still the back pressure. with macro ST_ASIO_PASSIVE_RECV, recv_msg also calls
+// socket::recv_msg() to read the socket.
+//send_msg uses the packer, it puts the msg into the send buffer immediately (even without co_await), the co_await completes after
+// the msg been sent to the kernel (SUCCESS) or discarded (NOT_APPLICABLE), see TCP_ASYNC_SEND_MSG.
+//after the link been broken (on_close), all waiting coroutines are resumed with failures, messages in the send buffer are discarded.
+//don't mix callbacks (on_msg_handle) with recv_msg, and send_msg here hides the send_msg series of tcp::socket_base.
+template<typename Socket> class coroutine_socket : public Socket
+{
+private:
+	typedef Socket super;
+
+public:
+	typedef typename super::in_msg_type in_msg_type;
+	typedef typename super::out_msg_type out_msg_type;
+
+	template<typename Arg> coroutine_socket(Arg& arg) : super(arg) {first_init();}
+	template<typename Arg1, typename Arg2> coroutine_socket(Arg1& arg1, Arg2& arg2) : super(arg1, arg2) {first_init();}
+
+	virtual void reset() {recv_waiter = connect_waiter = nullptr; recv_slot = NULL; msg_deferred = false; super::reset();}
+
+	class connect_awaiter
+	{
+	public:
+		connect_awaiter(coroutine_socket& socket_) : socket(socket_) {}
+
+		bool await_ready() const {return socket.is_connected();}
+		void await_suspend(std::coroutine_handle<> h) {socket.wait_connection(h);}
+		bool await_resume() const {return socket.is_connected();}
+
+	private:
+		coroutine_socket& socket;
+	};
+
+	class send_awaiter
+	{
+	public:
+		send_awaiter() : state(boost::make_shared<send_state>()) {}
+
+		bool await_ready() const {return DONE == state->status.load(boost::memory_order_acquire);}
+		bool await_suspend(std::coroutine_handle<> h) {state->waiter = h; return DONE != state->status.exchange(WAITING, boost::memory_order_acq_rel);}
+		sync_call_result await_resume() const {return state->result;}
+
+	private:
+		friend class coroutine_socket;
+		enum send_status {SENDING, WAITING, DONE};
+		struct send_state
+		{
+			send_state() : result(NOT_APPLICABLE) {status.store(SENDING, boost::memory_order_relaxed);}
+
+			sync_call_result result;
+			std::coroutine_handle<> waiter;
+			atomic_size_t status;
+		};
+
+		boost::shared_ptr<send_state> state;
+	};
+
+	class recv_awaiter
+	{
+	public:
+		recv_awaiter(coroutine_socket& socket_) : socket(socket_) {}
+
+		bool await_ready() const {return false;}
+		void await_suspend(std::coroutine_handle<> h) {socket.wait_msg(h, msg);}
+		out_msg_type await_resume() {out_msg_type re; re.swap(msg); return re;} //empty message means the link has been broken
+
+	private:
+		coroutine_socket& socket;
+		out_msg_type msg;
+	};
+
+	//client endpoint only, start connecting if not started, complete with true after the connection been established, or false after
+	// the connecting been abandoned (see generic_client_socket::prepare_reconnect).
+	connect_awaiter connect() {return connect_awaiter(*this);}
+
+	send_awaiter send_msg(const char* const pstr[], const size_t len[], size_t num, bool can_overflow = false, bool prior = false)
+	{
+		send_awaiter awaiter;
+		if (!ST_THIS async_send_msg(pstr, len, num, boost::bind(&coroutine_socket::on_msg_sent, this, awaiter.state, boost::placeholders::_1), can_overflow, prior))
+			awaiter.state->status.store(send_awaiter::DONE, boost::memory_order_release);
+
+		return awaiter;
+	}
+	send_awaiter send_msg(const char* pstr, size_t len, bool can_overflow = false, bool prior = false) {return send_msg(&pstr, &len, 1, can_overflow, prior);}
+	template<typename Buffer> send_awaiter send_msg(const Buffer& buffer, bool can_overflow = false, bool prior = false)
+		{return send_msg(buffer.data(), buffer.size(), can_overflow, prior);}
+
+	recv_awaiter recv_msg() {return recv_awaiter(*this);}
+
+protected:
+	//helper function, just call it in constructor
+	void first_init() {recv_slot = NULL; msg_deferred = false; ST_THIS msg_handling_interval(super::NO_DISPATCH_TIMER);}
+
+	virtual void on_connect() {super::on_connect(); ST_THIS post_in_dis_strand(boost::bind(&coroutine_socket::resume_connection_waiter, this));}
+	virtual void on_close()
+	{
+		typename super::in_container_type msg_can;
+		ST_THIS pop_all_pending_send_msg(msg_can); //fail all waiting send_msg
+
+		ST_THIS post_in_dis_strand(boost::bind(&coroutine_socket::resume_connection_waiter, this));
+		ST_THIS post_in_dis_strand(boost::bind(&coroutine_socket::resume_msg_waiter, this));
+		super::on_close();
+	}
+
+#ifdef ST_ASIO_DISPATCH_BATCH_MSG
+	virtual size_t on_msg_handle(typename super::out_queue_type& msg_can)
+	{
+		size_t re = 0;
+		typename super::out_msg msg;
+		for (; recv_waiter && msg_can.try_dequeue(msg); ++re) //the coroutine may wait for the next message before resume_msg_waiter returned
+#ifdef ST_ASIO_PASSIVE_RECV
+			if (msg.empty()) //no messages been parsed, see macro ST_ASIO_PASSIVE_RECV
+				super::recv_msg();
+			else
+#endif
+			{
+				recv_slot->swap(msg);
+				resume_msg_waiter();
+			}
+
+		if (0 == re)
+			msg_deferred = true;
+		return re;
+	}
+#else
+	virtual bool on_msg_handle(out_msg_type& msg)
+	{
+#ifdef ST_ASIO_PASSIVE_RECV
+		if (msg.empty()) //no messages been parsed, see macro ST_ASIO_PASSIVE_RECV
+		{
+			if (recv_waiter)
+				super::recv_msg();
+			return true;
+		}
+#endif
+		if (!recv_waiter)
+		{
+			msg_deferred = true;
+			return false;
+		}
+
+		recv_slot->swap(msg);
+		resume_msg_waiter();
+		return true;
+	}
+#endif
+
+private:
+	static void resume(std::coroutine_handle<> h) {h.resume();}
+
+	//connect_waiter is only accessed in dis_strand, on_connect and on_close resume it via post_in_dis_strand, so if the link been established
+	// after await_ready, either do_wait_connection sees it, or resume_connection_waiter runs after do_wait_connection.
+	void wait_connection(std::coroutine_handle<> h) {ST_THIS dispatch_in_dis_strand(boost::bind(&coroutine_socket::do_wait_connection, this, h));}
+	void do_wait_connection(std::coroutine_handle<> h)
+	{
+		assert(!connect_waiter);
+		if (ST_THIS is_connected()) //don't resume it in its await_suspend
+			return ST_THIS post_in_dis_strand(boost::bind(&coroutine_socket::resume, h));
+
+		connect_waiter = h;
+		if (!ST_THIS started())
+			ST_THIS start();
+	}
+	void resume_connection_waiter()
+	{
+		if (connect_waiter)
+		{
+			BOOST_AUTO(h, connect_waiter);
+			connect_waiter = nullptr;
+			h.resume();
+		}
+	}
+
+	void on_msg_sent(const boost::shared_ptr<typename send_awaiter::send_state>& state, sync_call_result re)
+	{
+		state->result = re;
+		if (send_awaiter::WAITING == state->status.exchange(send_awaiter::DONE, boost::memory_order_acq_rel))
+			ST_THIS post_in_dis_strand(boost::bind(&coroutine_socket::resume, state->waiter));
+	}
+
+	//recv_waiter, recv_slot and msg_deferred are only accessed in dis_strand
+	void wait_msg(std::coroutine_handle<> h, out_msg_type& msg)
+		{ST_THIS dispatch_in_dis_strand(boost::bind(&coroutine_socket::do_wait_msg, this, h, boost::ref(msg)));}
+	void do_wait_msg(std::coroutine_handle<> h, out_msg_type& msg)
+	{
+		assert(!recv_waiter);
+		if (!ST_THIS started()) //link broken, resume with an empty message, don't resume it in its await_suspend
+			return ST_THIS post_in_dis_strand(boost::bind(&coroutine_socket::resume, h));
+
+		recv_waiter = h;
+		recv_slot = &msg;
+#ifdef ST_ASIO_PASSIVE_RECV
+		super::recv_msg();
+#endif
+		if (msg_deferred)
+		{
+			msg_deferred = false;
+			ST_THIS resume_dispatch();
+		}
+	}
+	void resume_msg_waiter()
+	{
+		if (recv_waiter)
+		{
+			BOOST_AUTO(h, recv_waiter);
+			recv_waiter = nullptr;
+			recv_slot = NULL;
+			h.resume();
+		}
+	}
+
+private:
+	std::coroutine_handle<> connect_waiter; //only accessed in dis_strand
+
+	std::coroutine_handle<> recv_waiter;
+	out_msg_type* recv_slot;
+	bool msg_deferred; //on_msg_handle failed because of no waiting coroutines
+};
+
+}} //namespace
+
+#endif /* ST_ASIO_TCP_COROUTINE_SOCKET_H_ */
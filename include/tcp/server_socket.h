@@ -26,8 +26,9 @@ private:
 	typedef Socket super;
 
 public:
-	generic_server_socket(Server& server_) : super(server_.get_service_pump()), server(server_) {}
-	template<typename Arg> generic_server_socket(Server& server_, Arg& arg) : super(server_.get_service_pump(), arg), server(server_) {}
+	generic_server_socket(Server& server_) : super(server_.get_service_pump()), server(server_) {ST_THIS localize_unpacker(server.get_service_pump().is_thread_per_core());}
+	template<typename Arg> generic_server_socket(Server& server_, Arg& arg) : super(server_.get_service_pump(), arg), server(server_)
+		{ST_THIS localize_unpacker(server.get_service_pump().is_thread_per_core());}
 	~generic_server_socket() {ST_THIS clear_io_context_refs();}
 
 	virtual const char* type_name() const {return "TCP (server endpoint)";}
@@ -15,8 +15,48 @@
 
 #include "../socket.h"
 
+#ifdef ST_ASIO_ZEROCOPY
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY	60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY	0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY	5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED	1
+#endif
+#endif
+
+#if defined(ST_ASIO_ZEROCOPY) || defined(ST_ASIO_LAZY_RECV_BUFFER)
+#include <boost/type_traits/is_base_of.hpp>
+#endif
+
 namespace st_asio_wrapper { namespace tcp {
 
+//a const buffer sequence which refers to (not copies) a non-empty std::vector<boost::asio::const_buffer>, asio copies buffer sequences
+// into its operations, with this, no memory will be allocated, the vector must not be changed until the operation completed.
+class const_buffer_view
+{
+public:
+	typedef boost::asio::const_buffer value_type;
+	typedef const boost::asio::const_buffer* const_iterator;
+
+	explicit const_buffer_view(const std::vector<boost::asio::const_buffer>& buffers) : begin_(&buffers.front()), end_(begin_ + buffers.size()) {}
+
+	const_iterator begin() const {return begin_;}
+	const_iterator end() const {return end_;}
+
+private:
+	const_iterator begin_, end_;
+};
+
 template<typename Socket, typename OutMsgType> class reader_writer : public Socket
 {
 public:
@@ -26,7 +66,7 @@ public:
 	typedef boost::function<void(const boost::system::error_code& ec, size_t bytes_transferred)> ReadWriteCallBack;
 
 protected:
-	bool async_read(const ReadWriteCallBack& call_back)
+	template<typename CallBack> bool async_read(const CallBack& call_back)
 	{
 		BOOST_AUTO(recv_buff, ST_THIS unpacker()->prepare_next_recv());
 		assert(boost::asio::buffer_size(recv_buff) > 0);
@@ -50,8 +90,8 @@ protected:
 		return boost::asio::detail::default_max_transfer_size;
 #endif
 	}
-	template<typename Buffer>
-	void async_write(const Buffer& msg_can, const ReadWriteCallBack& call_back) {boost::asio::async_write(ST_THIS next_layer(), msg_can, call_back);}
+	template<typename Buffer, typename CallBack>
+	void async_write(const Buffer& msg_can, const CallBack& call_back) {boost::asio::async_write(ST_THIS next_layer(), msg_can, call_back);}
 
 private:
 	size_t completion_checker(const boost::system::error_code& ec, size_t bytes_transferred)
@@ -67,6 +107,7 @@ template<typename Socket, typename Packer, typename Unpacker,
 class socket_base : public ReaderWriter<socket<Socket, Packer, Unpacker, typename Packer::msg_type, typename Unpacker::msg_type, InQueue, InContainer, OutQueue, OutContainer>, typename Unpacker::msg_type>
 {
 public:
+	typedef Packer packer_type;
 	typedef typename Packer::msg_type in_msg_type;
 	typedef typename Packer::msg_ctype in_msg_ctype;
 	typedef typename Unpacker::msg_type out_msg_type;
@@ -75,11 +116,27 @@ public:
 private:
 	typedef ReaderWriter<socket<Socket, Packer, Unpacker, in_msg_type, out_msg_type, InQueue, InContainer, OutQueue, OutContainer>, out_msg_type> super;
 
+public:
+#ifdef ST_ASIO_MSG_DEADLINE
+	typedef typename super::msg_deadline msg_deadline;
+#endif
+
 protected:
 	enum link_status {CONNECTED, FORCE_SHUTTING_DOWN, GRACEFUL_SHUTTING_DOWN, BROKEN, HANDSHAKING};
 
-	socket_base(boost::asio::io_context& io_context_) : super(io_context_), status(BROKEN) {}
-	template<typename Arg> socket_base(boost::asio::io_context& io_context_, Arg& arg) : super(io_context_, arg), status(BROKEN) {}
+	socket_base(boost::asio::io_context& io_context_) : super(io_context_), status(BROKEN) {first_init();}
+	template<typename Arg> socket_base(boost::asio::io_context& io_context_, Arg& arg) : super(io_context_, arg), status(BROKEN) {first_init();}
+
+	//helper function, just call it in constructor
+	void first_init()
+	{
+#ifdef ST_ASIO_ZEROCOPY
+		zerocopy_status = 0;
+		zerocopy_sending = zerocopy_waiting = false;
+		zerocopy_seq = zerocopy_batch_seq = 0;
+		zerocopy_sent = 0;
+#endif
+	}
 
 public:
 	static const typename super::tid TIMER_BEGIN = super::TIMER_END;
@@ -103,7 +160,18 @@ public:
 	//notice, when reusing this socket, object_pool will invoke this function, so if you want to do some additional initialization
 	// for this socket, do it at here and in the constructor.
 	//for tcp::single_client_base and ssl::single_client_base, this virtual function will never be called, please note.
-	virtual void reset() {status = BROKEN; sending_msgs.clear(); super::reset();}
+	virtual void reset()
+	{
+		status = BROKEN;
+		sending_msgs.clear();
+#ifdef ST_ASIO_ZEROCOPY
+		clear_zerocopy_msgs();
+		zerocopy_status = 0;
+		zerocopy_sending = zerocopy_waiting = false;
+		zerocopy_seq = zerocopy_batch_seq = 0;
+#endif
+		super::reset();
+	}
 
 	//SOCKET status
 	link_status get_link_status() const {return status;}
@@ -207,6 +275,14 @@ public:
 	// use it any more, call the one that accepts reference of a message.
 	TCP_SEND_MSG(send_msg, false) //use the packer with native = false to pack the msgs
 	TCP_SEND_MSG(send_native_msg, true) //use the packer with native = true to pack the msgs
+	//lane 0 has the lowest priority and is used by all send_msg series above, see lane_queue for more details.
+	TCP_SEND_MSG_IN_LANE(send_msg_in_lane, false)
+	TCP_SEND_MSG_IN_LANE(send_native_msg_in_lane, true)
+#ifdef ST_ASIO_MSG_DEADLINE
+	//if the msg is still in send buffer when the deadline is reached, it will be discarded (see on_msg_discard) rather than being sent.
+	TCP_SEND_MSG_BEFORE(send_msg_before, false)
+	TCP_SEND_MSG_BEFORE(send_native_msg_before, true)
+#endif
 	//guarantee send msg successfully even if can_overflow equal to false
 	//success at here just means put the msg into tcp::socket_base's send buffer
 	TCP_SAFE_SEND_MSG(safe_send_msg, send_msg)
@@ -219,6 +295,9 @@ public:
 	//success at here just means put the msg into tcp::socket_base's send buffer
 	TCP_SYNC_SAFE_SEND_MSG(sync_safe_send_msg, sync_send_msg)
 	TCP_SYNC_SAFE_SEND_MSG(sync_safe_send_native_msg, sync_send_native_msg)
+	//don't wait for the sending, but get the result via a callback
+	TCP_ASYNC_SEND_MSG(async_send_msg, false) //use the packer with native = false to pack the msgs
+	TCP_ASYNC_SEND_MSG(async_send_native_msg, true) //use the packer with native = true to pack the msgs
 #endif
 #ifdef ST_ASIO_EXPOSE_SEND_INTERFACE
 	using super::send_msg;
@@ -241,7 +320,7 @@ protected:
 	virtual bool do_start()
 	{
 		status = CONNECTED;
-		stat.establish_time = time(NULL);
+		stat.establish_time = statistic::time_now();
 
 		on_connect(); //in this virtual function, stat.last_recv_time has not been updated (super::do_start will update it), please note
 		return super::do_start();
@@ -294,6 +373,7 @@ private:
 	using super::do_direct_send_msg;
 #ifdef ST_ASIO_SYNC_SEND
 	using super::do_direct_sync_send_msg;
+	using super::do_direct_async_send_msg;
 #endif
 
 	void _force_shutdown() {if (FORCE_SHUTTING_DOWN != status) shutdown();}
@@ -334,16 +414,41 @@ private:
 		else if (ST_THIS test_and_set_reading())
 			return;
 #endif
+#ifdef ST_ASIO_LAZY_RECV_BUFFER
+		//ssl and websocket may hold received data in their own buffers, so they cannot wait for readability on the lowest layer
+		//busy links (received data is pending) keep their buffers and read directly, so they don't pay an async_wait for each read
+		//ask the unpacker first, so unpackers which never release their buffers (the default one for example) don't pay a FIONREAD for each read
+		if (boost::is_base_of<typename Socket::lowest_layer_type, Socket>::value && ST_THIS unpacker()->can_release_buffer() && is_idle() &&
+			ST_THIS unpacker()->release_buffer())
+		{
+			ST_THIS lowest_layer().async_wait(boost::asio::socket_base::wait_read, make_strand_handler(rw_strand,
+				ST_THIS make_handler_error(ST_THIS reading_memory, boost::bind(&socket_base::wait_read_handler, this, boost::asio::placeholders::error))));
+			return;
+		}
+#endif
+		read_msg();
+	}
+
+	void read_msg()
+	{
 #ifdef ST_ASIO_PASSIVE_RECV
 		if (!ST_THIS async_read(make_strand_handler(rw_strand,
-			ST_THIS make_handler_error_size(boost::bind(&socket_base::recv_handler, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred)))))
+			ST_THIS make_handler_error_size(ST_THIS reading_memory, boost::bind(&socket_base::recv_handler, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred)))))
 			ST_THIS clear_reading();
 #else
 		ST_THIS async_read(make_strand_handler(rw_strand,
-			ST_THIS make_handler_error_size(boost::bind(&socket_base::recv_handler, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred))));
+			ST_THIS make_handler_error_size(ST_THIS reading_memory, boost::bind(&socket_base::recv_handler, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred))));
 #endif
 	}
 
+#ifdef ST_ASIO_LAZY_RECV_BUFFER
+	//no received data is pending, on error, just read and let the reading report it
+	bool is_idle() {boost::system::error_code ec; return 0 == ST_THIS lowest_layer().available(ec) && !ec;}
+
+	//data arrived, now it's time to ask the unpacker for a buffer
+	void wait_read_handler(const boost::system::error_code& ec) {if (ec) recv_handler(ec, 0); else read_msg();}
+#endif
+
 	void recv_handler(const boost::system::error_code& ec, size_t bytes_transferred)
 	{
 #ifdef ST_ASIO_PASSIVE_RECV
@@ -351,7 +456,7 @@ private:
 #endif
 		if (bytes_transferred > 0)
 		{
-			stat.last_recv_time = time(NULL);
+			stat.last_recv_time = statistic::time_now();
 
 			auto_duration dur(stat.unpack_time_sum);
 			bool unpack_ok = ST_THIS parse_msg(bytes_transferred, temp_msg_can);
@@ -388,18 +493,67 @@ private:
 
 		BOOST_AUTO(end_time, statistic::now());
 		send_buffer.move_items_out(ST_THIS batch_msg_send_size(), sending_msgs);
+#ifdef ST_ASIO_MSG_DEADLINE
+		while (ST_THIS discard_expired_msg(sending_msgs) && sending_msgs.empty())
+			send_buffer.move_items_out(ST_THIS batch_msg_send_size(), sending_msgs);
+#endif
+#ifdef ST_ASIO_BUFFER_BUDGET
+		ST_THIS charge_buffer_budget();
+#endif
 		sending_buffer.clear(); //this buffer will not be refreshed according to sending_msgs timely
+#if ST_ASIO_SEND_COALESCE_SIZE > 0
+		//copy adjacent small msgs into coalescing_buffer, so they go out as one buffer, reserve first to keep the buffers valid
+		size_t coalescing_size = 0;
+		for (BOOST_AUTO(iter, sending_msgs.begin()); iter != sending_msgs.end(); ++iter)
+			if (iter->size() < ST_ASIO_SEND_COALESCE_SIZE)
+				coalescing_size += iter->size();
+		coalescing_buffer.clear();
+		coalescing_buffer.reserve(coalescing_size);
+
+		bool coalescing = false;
+		for (BOOST_AUTO(iter, sending_msgs.begin()); iter != sending_msgs.end(); ++iter)
+		{
+			stat.send_delay_sum += end_time - iter->begin_time;
+			if (iter->size() >= ST_ASIO_SEND_COALESCE_SIZE)
+			{
+				sending_buffer.push_back(boost::asio::const_buffer(iter->data(), iter->size()));
+				coalescing = false;
+			}
+			else
+			{
+				if (coalescing)
+					sending_buffer.back() = boost::asio::const_buffer(sending_buffer.back().data(), sending_buffer.back().size() + iter->size());
+				else
+					sending_buffer.push_back(boost::asio::const_buffer(coalescing_buffer.data() + coalescing_buffer.size(), iter->size()));
+
+				coalescing_buffer.insert(coalescing_buffer.end(), iter->data(), iter->data() + iter->size());
+				coalescing = true;
+			}
+		}
+#else
 		for (BOOST_AUTO(iter, sending_msgs.begin()); iter != sending_msgs.end(); ++iter)
 		{
 			stat.send_delay_sum += end_time - iter->begin_time;
 			sending_buffer.push_back(boost::asio::const_buffer(iter->data(), iter->size()));
 		}
+#endif
 
 		if (!sending_buffer.empty())
 		{
 			sending_msgs.front().restart();
-			ST_THIS async_write(sending_buffer, make_strand_handler(rw_strand,
-				ST_THIS make_handler_error_size(boost::bind(&socket_base::send_handler, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred))));
+#ifdef ST_ASIO_ZEROCOPY
+			if (use_zerocopy(boost::asio::buffer_size(sending_buffer)))
+			{
+				zerocopy_sending = true;
+				zerocopy_batch_seq = zerocopy_seq;
+				zerocopy_sent = 0;
+				zerocopy_buffer = sending_buffer;
+				zerocopy_send();
+				return true;
+			}
+#endif
+			ST_THIS async_write(const_buffer_view(sending_buffer), make_strand_handler(rw_strand,
+				ST_THIS make_handler_error_size(ST_THIS sending_memory, boost::bind(&socket_base::send_handler, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred))));
 			return true;
 		}
 
@@ -411,54 +565,215 @@ private:
 	{
 		if (!ec)
 		{
-			stat.last_send_time = time(NULL);
+			stat.last_send_time = statistic::time_now();
 
 			stat.send_byte_sum += bytes_transferred;
 			stat.send_time_sum += statistic::now() - sending_msgs.front().begin_time;
+#if ST_ASIO_SEND_COALESCE_SIZE > 0
+			stat.send_msg_sum += sending_msgs.size(); //small msgs have been coalesced, so sending_buffer.size() is not the msg number any more
+#else
 			stat.send_msg_sum += sending_buffer.size(); //before gcc 5.0, std::list::size() has linear complexity, very embarrassing!
+#endif
+#ifdef ST_ASIO_ZEROCOPY
+			if (zerocopy_sending && zerocopy_seq != zerocopy_batch_seq) //the kernel may still refer to them, notify after the completion arrived
+				hold_zerocopy_msgs();
+			else
+#endif
+			notify_msg_send(sending_msgs);
+			sending_msgs.clear();
+#ifdef ST_ASIO_ZEROCOPY
+			zerocopy_sending = false;
+#endif
+			do_send_msg(true);
+		}
+		else
+		{
+#ifdef ST_ASIO_ZEROCOPY
+			zerocopy_sending = false;
+#endif
 #ifdef ST_ASIO_SYNC_SEND
 			for (BOOST_AUTO(iter, sending_msgs.begin()); iter != sending_msgs.end(); ++iter)
 				if (iter->p)
-					iter->p->set_value(SUCCESS);
+					iter->p->set_value(NOT_APPLICABLE);
+#endif
+			on_send_error(ec, sending_msgs);
+			sending_msgs.clear(); //clear sending messages after on_send_error, then user can decide how to deal with them in on_send_error
+
+			ST_THIS clear_sending();
+		}
+	}
+
+	void notify_msg_send(typename super::in_container_type& msg_can)
+	{
+#ifdef ST_ASIO_SYNC_SEND
+		for (BOOST_AUTO(iter, msg_can.begin()); iter != msg_can.end(); ++iter)
+			if (iter->p)
+				iter->p->set_value(SUCCESS);
 #endif
 #ifdef ST_ASIO_WANT_MSG_SEND_NOTIFY
-			ST_THIS on_msg_send(sending_msgs.front());
+		ST_THIS on_msg_send(msg_can.front());
 #elif defined(ST_ASIO_WANT_BATCH_MSG_SEND_NOTIFY)
-			on_msg_send(sending_msgs);
+		on_msg_send(msg_can);
 #endif
 #ifdef ST_ASIO_WANT_ALL_MSG_SEND_NOTIFY
-			if (send_buffer.is_empty())
+		if (send_buffer.is_empty())
 #if defined(ST_ASIO_WANT_MSG_SEND_NOTIFY) || !defined(ST_ASIO_WANT_BATCH_MSG_SEND_NOTIFY)
-				ST_THIS on_all_msg_send(sending_msgs.back());
+			ST_THIS on_all_msg_send(msg_can.back());
 #else
+		{
+			if (!msg_can.empty())
+				ST_THIS on_all_msg_send(msg_can.back());
+			else //on_msg_send consumed all messages
 			{
-				if (!sending_msgs.empty())
-					ST_THIS on_all_msg_send(sending_msgs.back());
-				else //on_msg_send consumed all messages
-				{
-					in_msg_type msg;
-					ST_THIS on_all_msg_send(msg);
-				}
+				in_msg_type msg;
+				ST_THIS on_all_msg_send(msg);
 			}
+		}
 #endif
 #endif
-			sending_msgs.clear();
-			do_send_msg(true);
+	}
+
+#ifdef ST_ASIO_ZEROCOPY
+	//return true if the current batch (bytes in total) should be sent with MSG_ZEROCOPY
+	bool use_zerocopy(size_t bytes)
+	{
+		//ssl and websocket cannot send data via the lowest layer directly
+		if (bytes < ST_ASIO_ZEROCOPY_SIZE || !boost::is_base_of<typename Socket::lowest_layer_type, Socket>::value)
+			return false;
+		else if (0 == zerocopy_status)
+		{
+			int on = 1;
+			if (0 == ::setsockopt(ST_THIS lowest_layer().native_handle(), SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)))
+				zerocopy_status = 1;
+			else
+			{
+				zerocopy_status = -1;
+				unified_out::info_out(ST_ASIO_LLF " zerocopy is not supported (%d), fall back to copying.", ST_THIS id(), errno);
+			}
 		}
-		else
+
+		return zerocopy_status > 0;
+	}
+
+	template<typename CallBack> void async_send_zerocopy(const CallBack& call_back, const boost::true_type&)
+		{ST_THIS next_layer().async_send(zerocopy_buffer, MSG_ZEROCOPY, call_back);}
+	template<typename CallBack> void async_send_zerocopy(const CallBack& call_back, const boost::false_type&) {assert(false);}
+
+	void zerocopy_send()
+	{
+		async_send_zerocopy(make_strand_handler(rw_strand, ST_THIS make_handler_error_size(boost::bind(&socket_base::zerocopy_send_handler, this,
+			boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred))), typename boost::is_base_of<typename Socket::lowest_layer_type, Socket>::type());
+	}
+
+	void zerocopy_send_handler(const boost::system::error_code& ec, size_t bytes_transferred)
+	{
+		if (!ec)
 		{
-#ifdef ST_ASIO_SYNC_SEND
-			for (BOOST_AUTO(iter, sending_msgs.begin()); iter != sending_msgs.end(); ++iter)
-				if (iter->p)
-					iter->p->set_value(NOT_APPLICABLE);
+			++zerocopy_seq; //every successful sendmsg consumes one sequence, even if the kernel copied the data finally
+			zerocopy_sent += bytes_transferred;
+			while (bytes_transferred > 0) //async_send may only send part of the data
+				if (bytes_transferred >= zerocopy_buffer.front().size())
+				{
+					bytes_transferred -= zerocopy_buffer.front().size();
+					zerocopy_buffer.erase(zerocopy_buffer.begin());
+				}
+				else
+				{
+					zerocopy_buffer.front() = zerocopy_buffer.front() + bytes_transferred;
+					bytes_transferred = 0;
+				}
+
+			if (!zerocopy_buffer.empty())
+				zerocopy_send();
+			else
+				send_handler(ec, zerocopy_sent);
+		}
+		else if (boost::asio::error::no_buffer_space == ec) //exceeded the optmem limit, send the rest via copying
+			ST_THIS async_write(zerocopy_buffer, make_strand_handler(rw_strand, ST_THIS make_handler_error_size(boost::bind(&socket_base::zerocopy_copy_handler,
+				this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred))));
+		else
+			send_handler(ec, zerocopy_sent + bytes_transferred);
+	}
+	void zerocopy_copy_handler(const boost::system::error_code& ec, size_t bytes_transferred) {send_handler(ec, zerocopy_sent + bytes_transferred);}
+
+	void hold_zerocopy_msgs()
+	{
+		zerocopy_msgs.emplace_back();
+		zerocopy_msgs.back().seq = zerocopy_seq - 1;
+		zerocopy_msgs.back().msgs.swap(sending_msgs);
+#if ST_ASIO_SEND_COALESCE_SIZE > 0
+		zerocopy_msgs.back().coalesced.swap(coalescing_buffer);
 #endif
-			on_send_error(ec, sending_msgs);
-			sending_msgs.clear(); //clear sending messages after on_send_error, then user can decide how to deal with them in on_send_error
+		release_zerocopy_msgs();
+	}
 
-			ST_THIS clear_sending();
+	void wait_zerocopy_completion()
+	{
+		if (!zerocopy_waiting)
+		{
+			zerocopy_waiting = true;
+			ST_THIS lowest_layer().async_wait(boost::asio::socket_base::wait_error, make_strand_handler(rw_strand,
+				ST_THIS make_handler_error(boost::bind(&socket_base::zerocopy_completion_handler, this, boost::asio::placeholders::error))));
+		}
+	}
+
+	void zerocopy_completion_handler(const boost::system::error_code& ec)
+	{
+		zerocopy_waiting = false;
+		if (!ec)
+			release_zerocopy_msgs();
+		else
+			clear_zerocopy_msgs();
+	}
+
+	//read completions from the error queue, then notify and release the completed msgs
+	void release_zerocopy_msgs()
+	{
+		if (zerocopy_msgs.empty())
+			return;
+
+		wait_zerocopy_completion(); //must wait before reading the error queue, otherwise, a completion may be missed
+		char control[128];
+		msghdr msg;
+		while (true)
+		{
+			memset(&msg, 0, sizeof(msg));
+			msg.msg_control = control;
+			msg.msg_controllen = sizeof(control);
+			if (::recvmsg(ST_THIS lowest_layer().native_handle(), &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+				break;
+
+			for (BOOST_AUTO(cm, CMSG_FIRSTHDR(&msg)); NULL != cm; cm = CMSG_NXTHDR(&msg, cm))
+				if ((SOL_IP == cm->cmsg_level && IP_RECVERR == cm->cmsg_type) || (SOL_IPV6 == cm->cmsg_level && IPV6_RECVERR == cm->cmsg_type))
+				{
+					const sock_extended_err* serr = (const sock_extended_err*) CMSG_DATA(cm);
+					if (0 != serr->ee_errno || SO_EE_ORIGIN_ZEROCOPY != serr->ee_origin)
+						continue;
+					else if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) //the kernel copied the data (loopback for example), zerocopy only brings overhead
+						zerocopy_status = -1;
+
+					//completions cover sequence ranges [ee_info, ee_data], and arrive in order generally
+					while (!zerocopy_msgs.empty() && (boost::int32_t) (zerocopy_msgs.front().seq - serr->ee_data) <= 0)
+					{
+						notify_msg_send(zerocopy_msgs.front().msgs);
+						zerocopy_msgs.pop_front();
+					}
+				}
 		}
 	}
 
+	void clear_zerocopy_msgs()
+	{
+#ifdef ST_ASIO_SYNC_SEND
+		for (BOOST_AUTO(iter, zerocopy_msgs.begin()); iter != zerocopy_msgs.end(); ++iter)
+			for (BOOST_AUTO(msg_iter, iter->msgs.begin()); msg_iter != iter->msgs.end(); ++msg_iter)
+				if (msg_iter->p)
+					msg_iter->p->set_value(NOT_APPLICABLE);
+#endif
+		zerocopy_msgs.clear();
+	}
+#endif
+
 	bool shutdown_handler(size_t loop_num)
 	{
 		if (GRACEFUL_SHUTTING_DOWN == status)
@@ -495,6 +810,30 @@ private:
 	//so use std::vector (member variable) to reduce memory allocation and keep the number of sending msgs (its size() has constant complexity, it's very important).
 	typename super::in_container_type sending_msgs;
 	std::vector<boost::asio::const_buffer> sending_buffer;
+#if ST_ASIO_SEND_COALESCE_SIZE > 0
+	//reused by every sending, so it holds at most one batch (see batch_msg_send_size) of small msgs.
+	//std::vector rather than std::string, because the latter may keep short content in itself (SSO) and then swap copies it,
+	//while zerocopy batches need the bytes to stay where they were until the kernel completes them (see hold_zerocopy_msgs).
+	std::vector<char> coalescing_buffer;
+#endif
+
+#ifdef ST_ASIO_ZEROCOPY
+	struct zerocopy_batch
+	{
+		boost::uint32_t seq; //the sequence of the last sendmsg invocation of this batch
+		typename super::in_container_type msgs;
+#if ST_ASIO_SEND_COALESCE_SIZE > 0
+		std::vector<char> coalesced; //swapped with coalescing_buffer, so the heap storage the kernel refers to moves here unchanged
+#endif
+	};
+
+	int zerocopy_status; //0 - not tried yet, 1 - enabled, -1 - not available
+	bool zerocopy_sending, zerocopy_waiting;
+	boost::uint32_t zerocopy_seq, zerocopy_batch_seq; //the kernel numbers every sendmsg (with MSG_ZEROCOPY) invocation from zero on each socket
+	size_t zerocopy_sent;
+	std::vector<boost::asio::const_buffer> zerocopy_buffer; //unsent part of sending_buffer
+	list<zerocopy_batch> zerocopy_msgs; //sent but not completed msgs, the kernel may still refer to them
+#endif
 };
 
 }} //namespace
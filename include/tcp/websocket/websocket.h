@@ -52,7 +52,8 @@ public:
 public:
 	template<class... Args> explicit stream(Args&&... args) : super(std::forward<Args>(args)...) {first_init();}
 
-	void async_read(const ReadWriteCallBack& call_back) {super::async_read(recv_buff, call_back);}
+	//pass copies (rvalues) of the handlers, beast invokes handlers as what they are passed, while allocated_handler cannot be invoked as const.
+	template<typename CallBack> void async_read(const CallBack& call_back) {super::async_read(recv_buff, CallBack(call_back));}
 	template<typename OutMsgType> bool parse_msg(list<OutMsgType>& msg_can)
 	{
 #if BOOST_VERSION < 107000
@@ -65,7 +66,7 @@ public:
 
 		return re;
 	}
-	template<typename Buffer> void async_write(const Buffer& buff, const ReadWriteCallBack& call_back) {super::async_write(buff, call_back);}
+	template<typename Buffer, typename CallBack> void async_write(const Buffer& buff, const CallBack& call_back) {super::async_write(buff, CallBack(call_back));}
 
 protected:
 	//helper function, just call it in constructor
@@ -19,7 +19,7 @@
 #include <boost/asio/system_timer.hpp>
 #endif
 
-#include "base.h"
+#include "executor.h"
 
 //If you inherit a class from class X, your own timer ids must begin from X::TIMER_END
 namespace st_asio_wrapper
@@ -62,8 +62,9 @@ public:
 		unsigned interval_ms;
 		timer_type timer;
 		boost::function<bool (tid)> call_back; //return true from call_back to continue the timer, or the timer will stop
+		strand_type* strand; //if not NULL, call_back will be called in it, see set_timer
 
-		timer_info(tid id_, boost::asio::io_context& io_context_) : id(id_), seq(-1), status(TIMER_CREATED), interval_ms(0), timer(io_context_) {}
+		timer_info(tid id_, boost::asio::io_context& io_context_) : id(id_), seq(-1), status(TIMER_CREATED), interval_ms(0), timer(io_context_), strand(NULL) {}
 		bool operator ==(const timer_info& other) {return id == other.id;}
 		bool operator ==(tid id_) {return id == id_;}
 	};
@@ -92,7 +93,7 @@ public:
 	void clear_io_context_refs() {sub_io_context_refs(io_context_refs);}
 
 	//after this call, call_back cannot be used again, please note.
-	bool create_or_update_timer(tid id, unsigned interval, boost::function<bool(tid)>& call_back, bool start = false)
+	bool create_or_update_timer(tid id, unsigned interval, boost::function<bool(tid)>& call_back, bool start = false, strand_type* strand = NULL)
 	{
 		timer_info* ti = NULL;
 		{
@@ -110,14 +111,15 @@ public:
 
 		ti->interval_ms = interval;
 		ti->call_back.swap(call_back);
+		ti->strand = strand;
 
 		if (start)
 			start_timer(*ti);
 
 		return true;
 	}
-	bool create_or_update_timer(tid id, unsigned interval, const boost::function<bool (tid)>& call_back, bool start = false)
-		{BOOST_AUTO(unused, call_back); return create_or_update_timer(id, interval, unused, start);}
+	bool create_or_update_timer(tid id, unsigned interval, const boost::function<bool (tid)>& call_back, bool start = false, strand_type* strand = NULL)
+		{BOOST_AUTO(unused, call_back); return create_or_update_timer(id, interval, unused, start, strand);}
 
 	bool change_timer_status(tid id, typename timer_info::timer_status status) {BOOST_AUTO(ti, find_timer(id)); return NULL != ti ? ti->status = status, true : false;}
 	bool change_timer_interval(tid id, unsigned interval) {BOOST_AUTO(ti, find_timer(id)); return NULL != ti ? ti->interval_ms = interval, true : false;}
@@ -129,6 +131,10 @@ public:
 	//after this call, call_back cannot be used again, please note.
 	bool set_timer(tid id, unsigned interval, boost::function<bool(tid)>& call_back) {return create_or_update_timer(id, interval, call_back, true);}
 	bool set_timer(tid id, unsigned interval, const boost::function<bool(tid)>& call_back) {return create_or_update_timer(id, interval, call_back, true);}
+	//call_back (and the restarting of this timer after it) will be called in strand, so if this timer is only manipulated in the same strand,
+	// it's thread safe (see the comments at the beginning of this class).
+	bool set_timer(strand_type& strand, tid id, unsigned interval, const boost::function<bool(tid)>& call_back)
+		{return create_or_update_timer(id, interval, call_back, true, &strand);}
 
 	timer_info* find_timer(tid id)
 	{
@@ -167,7 +173,11 @@ protected:
 #endif
 
 		//if timer already started, this will cancel it first
-		ti.timer.async_wait(ST_THIS make_handler_error(boost::bind(&timer::timer_handler, this, boost::asio::placeholders::error, boost::ref(ti), ++ti.seq)));
+		if (NULL != ti.strand)
+			ti.timer.async_wait(make_strand_handler(*ti.strand,
+				ST_THIS make_handler_error(boost::bind(&timer::timer_handler, this, boost::asio::placeholders::error, boost::ref(ti), ++ti.seq))));
+		else
+			ti.timer.async_wait(ST_THIS make_handler_error(boost::bind(&timer::timer_handler, this, boost::asio::placeholders::error, boost::ref(ti), ++ti.seq)));
 		return true;
 	}
 	bool start_timer(timer_info& ti) {return start_timer(ti, ti.interval_ms);}
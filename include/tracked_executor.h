@@ -15,14 +15,141 @@
 
 #include "executor.h"
 
+#if 0 == ST_ASIO_DELAY_CLOSE && defined(ST_ASIO_PER_THREAD_ACI)
+#include <climits>
+#include <cstring>
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/tss.hpp>
+#endif
+
 namespace st_asio_wrapper
 {
 
 #if 0 == ST_ASIO_DELAY_CLOSE
+#ifdef ST_ASIO_PER_THREAD_ACI
+//asynchronous calling indicator without a shared reference count, each thread counts the handlers it created and destroyed in its own slot
+// (cache line), so handlers created in rw_strand and destroyed in dis_strand (or vice versa) never bounce one cache line between threads.
+//the counters are monotonic, the sum of them is only reconciled when it's been asked (like is_async_calling and is_last_async_call).
+class aci_counter : public boost::noncopyable
+{
+public:
+	aci_counter() : raw(new char[(ST_ASIO_ACI_SLOTS + 1) * cache_line_size]), slots((slot*) ((size_t) (raw + cache_line_size - 1) & ~(cache_line_size - 1)))
+	{
+		for (size_t i = 0; i < ST_ASIO_ACI_SLOTS; ++i)
+			new (slots + i) slot();
+		slots[0].created = 1; //the owner, the same as shared_ptr's own reference
+	}
+	~aci_counter() {for (size_t i = 0; i < ST_ASIO_ACI_SLOTS; ++i) slots[i].~slot(); delete[] raw;}
+
+	void add_ref() const {++slots[thread_slot()].created;}
+	void release() const {++slots[thread_slot()].destroyed;}
+
+	//collect all counters twice, if nothing changed between the two collections, the sum was true at a moment between them (the counters
+	// are monotonic). if other threads keep creating or destroying handlers, then there must be other asynchronous calls on the fly,
+	// a number bigger than any real one will be returned to avoid spinning.
+	long use_count() const
+	{
+		boost::uint_fast64_t created[ST_ASIO_ACI_SLOTS], destroyed[ST_ASIO_ACI_SLOTS];
+		collect(created, destroyed);
+		for (int i = 0; i < 16; ++i)
+		{
+			boost::uint_fast64_t created2[ST_ASIO_ACI_SLOTS], destroyed2[ST_ASIO_ACI_SLOTS];
+			collect(created2, destroyed2);
+			if (0 == memcmp(created, created2, sizeof(created)) && 0 == memcmp(destroyed, destroyed2, sizeof(destroyed)))
+			{
+				boost::uint_fast64_t sum = 0;
+				for (size_t j = 0; j < ST_ASIO_ACI_SLOTS; ++j)
+					sum += created[j] - destroyed[j];
+				return (long) sum;
+			}
+
+			memcpy(created, created2, sizeof(created));
+			memcpy(destroyed, destroyed2, sizeof(destroyed));
+		}
+
+		return LONG_MAX;
+	}
+
+private:
+	enum {cache_line_size = 64};
+	struct slot
+	{
+		boost::atomic_uint_fast64_t created, destroyed;
+		slot() : created(0), destroyed(0) {}
+	};
+	BOOST_STATIC_ASSERT(sizeof(slot) <= cache_line_size);
+
+	void collect(boost::uint_fast64_t* created, boost::uint_fast64_t* destroyed) const
+		{for (size_t i = 0; i < ST_ASIO_ACI_SLOTS; ++i) {created[i] = slots[i].created; destroyed[i] = slots[i].destroyed;}}
+
+	//threads are numbered in the order of their first use, so service threads will get their own slots if there're enough slots.
+	static size_t thread_slot()
+	{
+		static boost::atomic_size_t thread_num(0);
+#ifndef BOOST_NO_CXX11_THREAD_LOCAL
+		static thread_local size_t index = thread_num++ % ST_ASIO_ACI_SLOTS;
+		return index;
+#else
+		static boost::thread_specific_ptr<size_t> indexes;
+		size_t* index = indexes.get();
+		if (NULL == index)
+			indexes.reset(index = new size_t(thread_num++ % ST_ASIO_ACI_SLOTS));
+		return *index;
+#endif
+	}
+
+private:
+	char* raw;
+	slot* slots; //cache line aligned, one slot per cache line
+};
+
+//a reference of aci_counter held by handlers, just like boost::shared_ptr<char>.
+class aci_ref
+{
+public:
+	aci_ref(const aci_counter& aci_) : aci(&aci_) {aci->add_ref();}
+	aci_ref(const aci_ref& other) : aci(other.aci) {if (NULL != aci) aci->add_ref();}
+#if defined(__GXX_EXPERIMENTAL_CXX0X__) || __cplusplus >= 201103L
+	aci_ref(aci_ref&& other) : aci(other.aci) {other.aci = NULL;}
+#endif
+	~aci_ref() {if (NULL != aci) aci->release();}
+
+private:
+	aci_ref& operator=(const aci_ref&);
+
+private:
+	const aci_counter* aci;
+};
+#else
+typedef boost::shared_ptr<char> aci_ref;
+#endif
+
+#if defined(ST_ASIO_HANDLER_ALLOCATOR) || defined(ST_ASIO_PER_THREAD_ACI)
+//hold a reference of aci during the asynchronous call, just like (aci, boost::lambda::bind(boost::lambda::unlambda(handler), ...)), but no boost::lambda.
+template<typename F> class tracked_handler
+{
+public:
+	template<typename Aci> tracked_handler(const Aci& aci_, const F& f_) : aci(aci_), f(f_) {}
+
+	void operator()() {f();}
+	void operator()(const boost::system::error_code& ec) {f(ec);}
+	void operator()(const boost::system::error_code& ec, size_t bytes_transferred) {f(ec, bytes_transferred);}
+
+private:
+	aci_ref aci;
+	F f;
+};
+#endif
+
 class tracked_executor
 {
 protected:
+#ifdef ST_ASIO_PER_THREAD_ACI
+	tracked_executor(boost::asio::io_context& _io_context_) : io_context_(_io_context_) {}
+#else
 	tracked_executor(boost::asio::io_context& _io_context_) : io_context_(_io_context_), aci(boost::make_shared<char>((char) ST_ASIO_MIN_ACI_REF)) {}
+#endif
 	virtual ~tracked_executor() {}
 
 public:
@@ -30,31 +157,65 @@ public:
 	typedef boost::function<void(const boost::system::error_code&, size_t)> handler_with_error_size;
 
 	bool stopped() const {return io_context_.stopped();}
+	boost::asio::io_context& get_io_context() {return io_context_;}
 
-	#if BOOST_ASIO_VERSION >= 101100
+	#if defined(ST_ASIO_HANDLER_ALLOCATOR) || defined(ST_ASIO_PER_THREAD_ACI)
+	template<typename F> void post(const F& handler) {boost::asio::post(io_context_, tracked_handler<F>(aci, handler));}
+	template<typename F> void defer(const F& handler) {boost::asio::defer(io_context_, tracked_handler<F>(aci, handler));}
+	template<typename F> void dispatch(const F& handler) {boost::asio::dispatch(io_context_, tracked_handler<F>(aci, handler));}
+	template<typename F> void post_strand(strand_type& strand, const F& handler) {boost::asio::post(strand, tracked_handler<F>(aci, handler));}
+	template<typename F> void defer_strand(strand_type& strand, const F& handler) {boost::asio::defer(strand, tracked_handler<F>(aci, handler));}
+	template<typename F> void dispatch_strand(strand_type& strand, const F& handler)
+		{boost::asio::dispatch(strand, tracked_handler<F>(aci, handler));}
+	#elif BOOST_ASIO_VERSION >= 101100
 	void post(const boost::function<void()>& handler) {boost::asio::post(io_context_, (aci, boost::lambda::bind(boost::lambda::unlambda(handler))));}
 	void defer(const boost::function<void()>& handler) {boost::asio::defer(io_context_, (aci, boost::lambda::bind(boost::lambda::unlambda(handler))));}
 	void dispatch(const boost::function<void()>& handler) {boost::asio::dispatch(io_context_, (aci, boost::lambda::bind(boost::lambda::unlambda(handler))));}
-	void post_strand(boost::asio::io_context::strand& strand, const boost::function<void()>& handler)
+	void post_strand(strand_type& strand, const boost::function<void()>& handler)
 		{boost::asio::post(strand, (aci, boost::lambda::bind(boost::lambda::unlambda(handler))));}
-	void defer_strand(boost::asio::io_context::strand& strand, const boost::function<void()>& handler)
+	void defer_strand(strand_type& strand, const boost::function<void()>& handler)
 		{boost::asio::defer(strand, (aci, boost::lambda::bind(boost::lambda::unlambda(handler))));}
-	void dispatch_strand(boost::asio::io_context::strand& strand, const boost::function<void()>& handler)
+	void dispatch_strand(strand_type& strand, const boost::function<void()>& handler)
 		{boost::asio::dispatch(strand, (aci, boost::lambda::bind(boost::lambda::unlambda(handler))));}
 	#else
 	void post(const boost::function<void()>& handler) {io_context_.post((aci, boost::lambda::bind(boost::lambda::unlambda(handler))));}
 	void dispatch(const boost::function<void()>& handler) {io_context_.dispatch((aci, boost::lambda::bind(boost::lambda::unlambda(handler))));}
-	void post_strand(boost::asio::io_context::strand& strand, const boost::function<void()>& handler)
+	void post_strand(strand_type& strand, const boost::function<void()>& handler)
 		{strand.post((aci, boost::lambda::bind(boost::lambda::unlambda(handler))));}
-	void dispatch_strand(boost::asio::io_context::strand& strand, const boost::function<void()>& handler)
+	void dispatch_strand(strand_type& strand, const boost::function<void()>& handler)
 		{strand.dispatch((aci, boost::lambda::bind(boost::lambda::unlambda(handler))));}
 	#endif
 
+	#ifdef ST_ASIO_PER_THREAD_ACI
+	handler_with_error make_handler_error(const handler_with_error& handler) const {return tracked_handler<handler_with_error>(aci, handler);}
+	handler_with_error_size make_handler_error_size(const handler_with_error_size& handler) const {return tracked_handler<handler_with_error_size>(aci, handler);}
+	#else
 	handler_with_error make_handler_error(const handler_with_error& handler) const {return (aci, boost::lambda::bind(boost::lambda::unlambda(handler), boost::lambda::_1));}
 	handler_with_error_size make_handler_error_size(const handler_with_error_size& handler) const
 		{return (aci, boost::lambda::bind(boost::lambda::unlambda(handler), boost::lambda::_1, boost::lambda::_2));}
+	#endif
+	#ifdef ST_ASIO_HANDLER_ALLOCATOR
+	template<typename F> allocated_handler<tracked_handler<F> > make_handler_error(handler_memory& memory, const F& handler) const
+		{return allocated_handler<tracked_handler<F> >(memory, tracked_handler<F>(aci, handler));}
+	template<typename F> allocated_handler<tracked_handler<F> > make_handler_error_size(handler_memory& memory, const F& handler) const
+		{return allocated_handler<tracked_handler<F> >(memory, tracked_handler<F>(aci, handler));}
+	#else
+	handler_with_error make_handler_error(handler_memory&, const handler_with_error& handler) const {return make_handler_error(handler);}
+	handler_with_error_size make_handler_error_size(handler_memory&, const handler_with_error_size& handler) const {return make_handler_error_size(handler);}
+	#endif
 
 	long get_aci_ref() const {return aci.use_count();}
+	#ifdef ST_ASIO_PER_THREAD_ACI
+	bool is_async_calling() const {return aci.use_count() > 1;}
+	int is_last_async_call() const //can only be called in callbacks, 0-not, -1-fault error, 1-yes
+	{
+		long cur_ref = aci.use_count();
+		if (cur_ref > ST_ASIO_MIN_ACI_REF)
+			return 0;
+
+		return cur_ref < ST_ASIO_MIN_ACI_REF ? -1 : 1;
+	}
+	#else
 	bool is_async_calling() const {return !aci.unique();}
 	int is_last_async_call() const //can only be called in callbacks, 0-not, -1-fault error, 1-yes
 	{
@@ -64,13 +225,18 @@ public:
 
 		return cur_ref < *aci ? -1 : 1;
 	}
+	#endif
 	inline void set_async_calling(bool) {}
 
 protected:
 	boost::asio::io_context& io_context_;
 
 private:
+#ifdef ST_ASIO_PER_THREAD_ACI
+	aci_counter aci; //asynchronous calling indicator
+#else
 	boost::shared_ptr<char> aci; //asynchronous calling indicator
+#endif
 };
 #else
 class tracked_executor : public executor
@@ -220,7 +220,7 @@ protected:
 
 	virtual bool on_heartbeat_error()
 	{
-		stat.last_recv_time = time(NULL); //avoid repetitive warnings
+		stat.last_recv_time = statistic::time_now(); //avoid repetitive warnings
 		unified_out::warning_out(ST_ASIO_LLF " %s is not available", ST_THIS id(), endpoint_to_string(peer_addr).data());
 		return true;
 	}
@@ -244,7 +244,19 @@ protected:
 	virtual bool do_send_msg(const typename super::in_msg& msg) {return false;} //customize message sending, for connected socket only
 	virtual void pre_handle_msg(typename Unpacker::container_type& msg_can) {}
 
-	void resume_sending() {ST_THIS clear_sending(); if (!send_buffer.is_empty()) super::send_msg();} //for reliable UDP socket only
+	void resume_sending() //for reliable UDP socket only
+	{
+#ifdef ST_ASIO_SINGLE_THREAD_CONTEXT
+		if (!ST_THIS in_io_thread()) //sending and the send buffer can only be touched in the service thread
+		{
+			ST_THIS post_in_io_strand(boost::bind(&generic_socket::resume_sending, this));
+			return;
+		}
+#endif
+		ST_THIS clear_sending();
+		if (!send_buffer.is_empty())
+			super::send_msg();
+	}
 
 private:
 	using super::close;
@@ -279,10 +291,10 @@ private:
 		{
 			if (is_connected)
 				ST_THIS next_layer().async_receive(recv_buff, make_strand_handler(rw_strand,
-					ST_THIS make_handler_error_size(boost::bind(&generic_socket::recv_handler, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred))));
+					ST_THIS make_handler_error_size(ST_THIS reading_memory, boost::bind(&generic_socket::recv_handler, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred))));
 			else
 				ST_THIS next_layer().async_receive_from(recv_buff, temp_addr, make_strand_handler(rw_strand,
-					ST_THIS make_handler_error_size(boost::bind(&generic_socket::recv_handler, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred))));
+					ST_THIS make_handler_error_size(ST_THIS reading_memory, boost::bind(&generic_socket::recv_handler, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred))));
 			return;
 		}
 
@@ -298,7 +310,7 @@ private:
 #endif
 		if (!ec && bytes_transferred > 0)
 		{
-			stat.last_recv_time = time(NULL);
+			stat.last_recv_time = statistic::time_now();
 
 			typename Unpacker::container_type msg_can;
 			ST_THIS unpacker()->parse_msg(bytes_transferred, msg_can);
@@ -333,18 +345,25 @@ private:
 			return true;
 		else if (is_connected && !check_send_cc())
 			return false;
+#ifdef ST_ASIO_MSG_DEADLINE
+		else if (ST_THIS try_dequeue_unexpired_msg(sending_msg))
+#else
 		else if (send_buffer.try_dequeue(sending_msg))
+#endif
 		{
+#ifdef ST_ASIO_BUFFER_BUDGET
+			ST_THIS charge_buffer_budget();
+#endif
 			stat.send_delay_sum += statistic::now() - sending_msg.begin_time;
 			sending_msg.restart();
 			if (!is_connected)
 				ST_THIS next_layer().async_send_to(boost::asio::buffer(sending_msg.data(), sending_msg.size()), sending_msg.peer_addr, make_strand_handler(rw_strand,
-					ST_THIS make_handler_error_size(boost::bind(&generic_socket::send_handler, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred))));
+					ST_THIS make_handler_error_size(ST_THIS sending_memory, boost::bind(&generic_socket::send_handler, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred))));
 			else if (do_send_msg(sending_msg))
 				ST_THIS post_in_io_strand(boost::bind(&generic_socket::send_handler, this, boost::system::error_code(), sending_msg.size()));
 			else
 				ST_THIS next_layer().async_send(boost::asio::buffer(sending_msg.data(), sending_msg.size()), make_strand_handler(rw_strand,
-					ST_THIS make_handler_error_size(boost::bind(&generic_socket::send_handler, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred))));
+					ST_THIS make_handler_error_size(ST_THIS sending_memory, boost::bind(&generic_socket::send_handler, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred))));
 			return true;
 		}
 
@@ -356,7 +375,7 @@ private:
 	{
 		if (!ec)
 		{
-			stat.last_send_time = time(NULL);
+			stat.last_send_time = statistic::time_now();
 
 			stat.send_byte_sum += bytes_transferred;
 			stat.send_time_sum += statistic::now() - sending_msg.begin_time;